@@ -0,0 +1,80 @@
+#!/usr/bin/env python3
+"""
+Compare two runs of the algorithm benchmarks and fail on regressions.
+
+Both inputs are console logs of the benchmark suite in tests/benchmarks, such
+as the handler.log that twister keeps of a run. Other output is ignored:
+
+    bench_compare.py --tolerance 10 baseline.log current.log
+
+A benchmark regresses when its cycles per operation grew by more than the
+tolerance, in percent. Benchmarks which only exist in one of the runs are
+listed but do not fail the comparison.
+"""
+
+import argparse
+import sys
+
+
+def parse(path):
+    """Map benchmark name to cycles per operation."""
+    results = {}
+
+    with open(path, errors="replace") as f:
+        for line in f:
+            # Log timestamps or prefixes may precede the CSV
+            start = line.find("bench,")
+
+            if start < 0:
+                continue
+
+            fields = line[start:].strip().split(",")
+
+            if len(fields) != 6 or fields[1] == "name":
+                continue
+
+            try:
+                results[fields[1]] = int(fields[4])
+            except ValueError:
+                continue
+
+    return results
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("--tolerance", type=float, default=5.0,
+                        help="allowed growth of cycles per operation, in percent")
+    parser.add_argument("baseline")
+    parser.add_argument("current")
+    args = parser.parse_args()
+
+    baseline = parse(args.baseline)
+    current = parse(args.current)
+    regressions = 0
+
+    if not baseline or not current:
+        sys.exit("No benchmark results found")
+
+    print(f"{'benchmark':<20} {'baseline':>10} {'current':>10} {'change':>8}")
+
+    for name in sorted(baseline.keys() | current.keys()):
+        if name not in baseline or name not in current:
+            print(f"{name:<20} {baseline.get(name, '-'):>10} {current.get(name, '-'):>10} {'':>8}")
+            continue
+
+        before, after = baseline[name], current[name]
+        change = (after - before) * 100 / before if before else 0.0
+        flag = ""
+
+        if change > args.tolerance:
+            flag = "  REGRESSION"
+            regressions += 1
+
+        print(f"{name:<20} {before:>10} {after:>10} {change:>+7.1f}%{flag}")
+
+    sys.exit(1 if regressions else 0)
+
+
+if __name__ == "__main__":
+    main()
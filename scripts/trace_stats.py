@@ -0,0 +1,182 @@
+#!/usr/bin/env python3
+"""
+Per-stage latency and preemption statistics of the input pipeline.
+
+Reads a CTF trace of a build with overlay-tracing.conf, using the babeltrace2
+Python bindings and the CTF metadata of the Zephyr tree the firmware was
+built with:
+
+    trace_stats.py --metadata $ZEPHYR_BASE/subsys/tracing/ctf/tsdl/metadata TRACE.CTF
+
+Stages are delimited by the named events of app_trace.h:
+
+    scan          scan_start to scan_end
+    scan_period   scan_start to the next scan_start
+    report        debounce (accepted state change) to the first hid_send after it
+
+Preemption is the time other threads and interrupts ran while a scan was in
+progress, per thread or interrupt.
+"""
+
+import argparse
+import collections
+import os
+import shutil
+import sys
+import tempfile
+
+try:
+    import bt2
+except ImportError:
+    sys.exit("The babeltrace2 Python bindings are required (python3-bt2)")
+
+
+def prepare(trace, metadata):
+    """Copy the stream and its metadata into a directory babeltrace can open.
+
+    A trace from the RAM buffer is padded with zeros up to the size of the
+    buffer, the padding is cut off.
+    """
+    directory = tempfile.mkdtemp(prefix="trace_stats")
+
+    with open(trace, "rb") as src:
+        data = src.read().rstrip(b"\0")
+
+    with open(os.path.join(directory, "channel0_0"), "wb") as dst:
+        dst.write(data)
+
+    shutil.copy(metadata, os.path.join(directory, "metadata"))
+
+    return directory
+
+
+def events(directory):
+    """Yield (timestamp_ns, name, payload) until the end of the stream.
+
+    A truncated last event ends the iteration instead of raising.
+    """
+    iterator = iter(bt2.TraceCollectionMessageIterator(directory))
+
+    while True:
+        try:
+            msg = next(iterator)
+        except StopIteration:
+            return
+        except bt2._Error as error:
+            print(f"warning: trace ends with a broken event: {error}", file=sys.stderr)
+            return
+
+        if type(msg) is not bt2._EventMessageConst:
+            continue
+
+        timestamp = msg.default_clock_snapshot.ns_from_origin
+        payload = {str(name): value for name, value in msg.event.payload_field.items()}
+
+        yield timestamp, msg.event.name, payload
+
+
+def summary(name, samples):
+    if not samples:
+        print(f"{name:<16} no samples")
+        return
+
+    samples = sorted(samples)
+    p99 = samples[min(len(samples) - 1, len(samples) * 99 // 100)]
+    mean = sum(samples) / len(samples)
+
+    print(f"{name:<16} n {len(samples):<6} min {samples[0] / 1000:9.1f} us  "
+          f"mean {mean / 1000:9.1f} us  p99 {p99 / 1000:9.1f} us  max {samples[-1] / 1000:9.1f} us")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--metadata", required=True, help="CTF metadata of the Zephyr tree")
+    parser.add_argument("--scan-thread", default="app_workq", help="thread which runs the scan")
+    parser.add_argument("trace", help="TRACE.CTF from the drive, or channel0_0 from native_sim")
+    args = parser.parse_args()
+
+    directory = prepare(args.trace, args.metadata)
+
+    stages = collections.defaultdict(list)
+    preemption = collections.Counter()
+    preemption_count = collections.Counter()
+
+    scan_start = prev_scan_start = None
+    pending_touch = None
+    running = None              # thread or ISR currently on the CPU, other than the scan thread
+    running_since = None
+    isr_stack = []
+
+    def account(now):
+        if scan_start is not None and running is not None:
+            preemption[running] += now - running_since
+
+    try:
+        for timestamp, name, payload in events(directory):
+            if name == "named_event":
+                event = str(payload["name"])
+
+                if event == "scan_start":
+                    scan_start = timestamp
+
+                    if prev_scan_start is not None:
+                        stages["scan_period"].append(timestamp - prev_scan_start)
+
+                    prev_scan_start = timestamp
+                elif event == "scan_end" and scan_start is not None:
+                    account(timestamp)
+                    running_since = timestamp
+                    stages["scan"].append(timestamp - scan_start)
+                    scan_start = None
+                elif event == "debounce":
+                    pending_touch = timestamp
+                elif event == "hid_send" and pending_touch is not None:
+                    stages["report"].append(timestamp - pending_touch)
+                    pending_touch = None
+
+            elif name == "thread_switched_in":
+                thread = str(payload.get("name", payload.get("thread_id")))
+                account(timestamp)
+
+                if thread == args.scan_thread:
+                    running = None
+                else:
+                    running = f"thread {thread}"
+
+                    if scan_start is not None:
+                        preemption_count[running] += 1
+
+                running_since = timestamp
+
+            elif name == "isr_enter":
+                account(timestamp)
+                isr_stack.append(running)
+                running = "isr"
+                running_since = timestamp
+
+                if scan_start is not None:
+                    preemption_count[running] += 1
+
+            elif name == "isr_exit" and isr_stack:
+                account(timestamp)
+                running = isr_stack.pop()
+                running_since = timestamp
+    finally:
+        shutil.rmtree(directory)
+
+    print("Stage latency")
+    for stage in ("scan", "scan_period", "report"):
+        summary(stage, stages[stage])
+
+    print()
+    print("Preemption during scans")
+
+    if not preemption:
+        print("none")
+
+    for who, total in preemption.most_common():
+        print(f"{who:<24} {preemption_count[who]:>6} times  {total / 1000:10.1f} us")
+
+
+if __name__ == "__main__":
+    main()
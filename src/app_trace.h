@@ -0,0 +1,42 @@
+/**
+ * @file    app_trace.h
+ * @author  Matthijs Bakker
+ * @date    2026-10-18
+ * @brief   Trace points on the input hot path
+ *
+ * Messages on the path from touch to HID report are trace points rather
+ * than regular log messages. Without CONFIG_APP_TRACE they compile to
+ * nothing, but their arguments are still type checked. With it, they are
+ * logged at the info level of the calling module.
+ *
+ * APP_TRACE_EVENT() marks a stage of the input pipeline in the CTF trace
+ * of a tracing build, see overlay-tracing.conf.
+ */
+
+#include <zephyr/logging/log.h>
+
+#if CONFIG_APP_TRACE_EVENTS
+
+#include <zephyr/tracing/tracing.h>
+
+#define APP_TRACE_EVENT(name, arg0, arg1)   sys_trace_named_event(name, arg0, arg1)
+
+#else
+
+#define APP_TRACE_EVENT(name, arg0, arg1)   ((void)0)
+
+#endif
+
+#if CONFIG_APP_TRACE
+
+#define APP_TRACE(...)                      LOG_INF(__VA_ARGS__)
+#define APP_TRACE_HEXDUMP(data, len, str)   LOG_HEXDUMP_INF(data, len, str)
+
+#else
+
+#define APP_TRACE(...) \
+	do { if (0) { LOG_INF(__VA_ARGS__); } } while (0)
+#define APP_TRACE_HEXDUMP(data, len, str) \
+	do { if (0) { LOG_HEXDUMP_INF(data, len, str); } } while (0)
+
+#endif
@@ -0,0 +1,31 @@
+/**
+ * @file    app_workq.c
+ * @author  Matthijs Bakker
+ * @date    2026-10-18
+ * @brief   Application work queue
+ */
+
+#include "app_workq.h"
+
+K_THREAD_STACK_DEFINE(app_workq_stack, CONFIG_APP_WORKQ_STACK_SIZE);
+K_THREAD_STACK_DEFINE(hid_workq_stack, CONFIG_APP_HID_WORKQ_STACK_SIZE);
+
+struct k_work_q app_workq;
+struct k_work_q hid_workq;
+
+int app_workq_init(void)
+{
+	const struct k_work_queue_config config = {
+		.name = "app_workq",
+	};
+	const struct k_work_queue_config hid_config = {
+		.name = "hid_workq",
+	};
+
+	k_work_queue_start(&app_workq, app_workq_stack, K_THREAD_STACK_SIZEOF(app_workq_stack),
+			   CONFIG_APP_WORKQ_PRIORITY, &config);
+	k_work_queue_start(&hid_workq, hid_workq_stack, K_THREAD_STACK_SIZEOF(hid_workq_stack),
+			   CONFIG_APP_HID_WORKQ_PRIORITY, &hid_config);
+
+	return 0;
+}
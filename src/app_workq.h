@@ -0,0 +1,24 @@
+/**
+ * @file    app_workq.h
+ * @author  Matthijs Bakker
+ * @date    2026-10-18
+ * @brief   Application work queue
+ *
+ * Scanning, touch handling and building HID reports all run as work items
+ * on this single queue, so they are strictly ordered and share a single
+ * stack. The reports are sent from a second queue, where waiting for a
+ * Bluetooth buffer does not hold up the scan.
+ */
+
+#include <zephyr/kernel.h>
+
+extern struct k_work_q app_workq;
+extern struct k_work_q hid_workq;
+
+/**
+ * Start the application and HID report work queue threads.
+ *
+ * @returns 0 on success,
+ *          >0 on failure
+ */
+int app_workq_init(void);
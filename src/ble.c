@@ -9,6 +9,8 @@
 
 #include "ble.h"
 
+#include <string.h>
+
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
 #include <zephyr/settings/settings.h>
@@ -21,7 +23,17 @@
 
 #include <bluetooth/services/hids.h>
 
-#include "led.h"
+#include "app_trace.h"
+#include "app_workq.h"
+#include "bus.h"
+#include "cache_prof.h"
+#include "energy.h"
+#include "gesture.h"
+#include "health.h"
+#include "keymap.h"
+#include "power.h"
+#include "slide.h"
+#include "telemetry.h"
 
 #define BASE_USB_HID_SPEC_VERSION   		0x0101
 #define INPUT_REPORT_KEYS_MAX_LEN 			(1 + 1 + 6) // modifiers + reserved + keys[6]
@@ -38,6 +50,9 @@
 #define INPUT_REP_KEYS_IDX					0
 #define INPUT_REP_CONSUMER_IDX				1
 
+// Report map item for each usage of the consumer report
+#define CONSUMER_USAGE_ITEM(name, id)		0x09, id,
+
 static const struct bt_data ad[] = {
 	BT_DATA_BYTES(BT_DATA_GAP_APPEARANCE,
 		      (CONFIG_BT_DEVICE_APPEARANCE >> 0) & 0xff,
@@ -50,12 +65,24 @@ static const struct bt_data sd[] = {
 	BT_DATA(BT_DATA_NAME_COMPLETE, CONFIG_BT_DEVICE_NAME, (sizeof(CONFIG_BT_DEVICE_NAME) - 1)),
 };
 
+#define REPORTS_IN_FLIGHT           4       // timed notifications per connection
+#define REPORTS_QUEUED              16      // waiting for the HID work queue
+
 static struct conn_mode {
 	struct bt_conn *conn;
 	bool in_boot_mode;
+	uint32_t energy_ua;         // radio current at the interval of the connection
+
+	// Accepted state changes of the timed reports in flight, oldest first
+	uint32_t report_cyc[REPORTS_IN_FLIGHT];
+	uint8_t report_head;
+	uint8_t report_count;
 } conn_mode[CONFIG_BT_HIDS_MAX_CLIENT_COUNT];
 
+static struct k_spinlock report_lock;
+
 static struct k_work pairing_work;
+static struct k_work_delayable gesture_work;
 
 struct pairing_data_mitm {
 	struct bt_conn *conn;
@@ -63,14 +90,126 @@ struct pairing_data_mitm {
 };
 
 static bool alt_mode = false;
+static bool suspended = false;
+static bool advertising = false;
+
+// Owned by the application work queue
+static ble_hid_key_t reported_mask = 0;
+static bool reported_known = true;  // false after a dropped report left the host state unknown
+static uint32_t report_timestamp_cyc = 0;
+static gesture_engine_t gestures;
+
+#if CONFIG_APP_SLIDE
+static slide_t slide;
+static bool sliding = false;
+static bool holding = false;        // key reports wait for the slide detector
+static ble_hid_key_t held_mask = 0;
+static ble_hid_key_t held_tap = 0;  // pressed and released again while held
+static uint32_t held_cyc = 0;
+#endif
 
 K_MSGQ_DEFINE(mitm_queue, sizeof(struct pairing_data_mitm), CONFIG_BT_HIDS_MAX_CLIENT_COUNT, 4);
-K_MSGQ_DEFINE(input_queue, sizeof(ble_key_input_t), 10, 1);
+
+typedef struct {
+	uint32_t timestamp_cyc;     // of the accepted state change, 0 if not timed
+	uint8_t index;
+	uint8_t len;
+	uint8_t data[MAX(INPUT_REPORT_KEYS_MAX_LEN, INPUT_REPORT_CONSUMER_MAX_LEN)];
+} queued_report_t;
+
+// Built on the application work queue, sent from the HID work queue
+K_MSGQ_DEFINE(report_queue, sizeof(queued_report_t), REPORTS_QUEUED, 4);
+
+static struct k_work report_work;
 
 BT_HIDS_DEF(hids_obj, OUTPUT_REPORT_MAX_LEN, INPUT_REPORT_KEYS_MAX_LEN, INPUT_REPORT_CONSUMER_MAX_LEN);
 
+#define DOUBLE_TAP_MS               400
+#define LONG_PRESS_MS               1000
+
+typedef enum {
+	GESTURE_ACTION_MODE_SWITCH,
+	GESTURE_ACTION_PAIRING_ACCEPT,
+	GESTURE_ACTION_SLOT,        // GESTURE_ACTION_SLOT + n sends keymap slot n
+} gesture_action_t;
+
+#define GESTURE_SLOT(gesture, keys, ms, slot) \
+	{ .type = (gesture), .mask = (keys), .time_ms = (ms), .action = GESTURE_ACTION_SLOT + (slot) }
+
+static const gesture_def_t gesture_table[] = {
+	{
+		.type = GESTURE_LONG_PRESS,
+		.mask = BLE_HID_KEY_MUTE,
+		.time_ms = 3000,
+		.action = GESTURE_ACTION_MODE_SWITCH,
+	},
+	{
+		.type = GESTURE_CHORD_HOLD,
+		.mask = BLE_HID_KEY_VOLUME_UP | BLE_HID_KEY_VOLUME_DOWN,
+		.time_ms = 3000,
+		.action = GESTURE_ACTION_PAIRING_ACCEPT,
+	},
+	GESTURE_SLOT(GESTURE_DOUBLE_TAP, BLE_HID_KEY_MUTE, DOUBLE_TAP_MS, KEYMAP_SLOT_DOUBLE_TAP_KEY0),
+	GESTURE_SLOT(GESTURE_DOUBLE_TAP, BLE_HID_KEY_PLAYPAUSE, DOUBLE_TAP_MS, KEYMAP_SLOT_DOUBLE_TAP_KEY1),
+	GESTURE_SLOT(GESTURE_DOUBLE_TAP, BLE_HID_KEY_VOLUME_UP, DOUBLE_TAP_MS, KEYMAP_SLOT_DOUBLE_TAP_KEY2),
+	GESTURE_SLOT(GESTURE_DOUBLE_TAP, BLE_HID_KEY_VOLUME_DOWN, DOUBLE_TAP_MS, KEYMAP_SLOT_DOUBLE_TAP_KEY3),
+	// The mode switch of key 0 continues the same hold
+	GESTURE_SLOT(GESTURE_LONG_PRESS, BLE_HID_KEY_MUTE, LONG_PRESS_MS, KEYMAP_SLOT_LONG_PRESS_KEY0),
+	GESTURE_SLOT(GESTURE_LONG_PRESS, BLE_HID_KEY_PLAYPAUSE, LONG_PRESS_MS, KEYMAP_SLOT_LONG_PRESS_KEY1),
+	GESTURE_SLOT(GESTURE_LONG_PRESS, BLE_HID_KEY_VOLUME_UP, LONG_PRESS_MS, KEYMAP_SLOT_LONG_PRESS_KEY2),
+	GESTURE_SLOT(GESTURE_LONG_PRESS, BLE_HID_KEY_VOLUME_DOWN, LONG_PRESS_MS, KEYMAP_SLOT_LONG_PRESS_KEY3),
+	GESTURE_SLOT(GESTURE_CHORD, BLE_HID_KEY_VOLUME_UP | BLE_HID_KEY_VOLUME_DOWN, 0, KEYMAP_SLOT_CHORD_KEY2_KEY3),
+};
+
 LOG_MODULE_REGISTER(ble);
 
+static int connection_count(void)
+{
+	int i, count = 0;
+
+	for (i = 0; i < CONFIG_BT_HIDS_MAX_CLIENT_COUNT; i++) {
+		if (conn_mode[i].conn) {
+			++count;
+		}
+	}
+
+	return count;
+}
+
+static void conn_notify(bool connected)
+{
+	bus_conn_msg_t msg = {
+		.connected = connected,
+		.connections = connection_count(),
+	};
+
+	bus_publish(&bus_conn_chan, &msg);
+}
+
+static void ui_notify(bus_ui_event_t event)
+{
+	bus_ui_msg_t msg = {
+		.event = event,
+	};
+
+	bus_publish(&bus_ui_chan, &msg);
+}
+
+static void advertising_set(bool on)
+{
+	if (on == advertising) {
+		return;
+	}
+
+	advertising = on;
+
+	if (on) {
+		ENERGY_ON(ADVERTISING);
+	} else {
+		ENERGY_OFF(ADVERTISING);
+	}
+}
+
 static void advertising_start(void)
 {
 	const struct bt_le_adv_param *adv_param = BT_LE_ADV_PARAM(
@@ -80,6 +219,10 @@ static void advertising_start(void)
 						NULL);
 	int err;
 
+	if (suspended) {
+		return;
+	}
+
 	err = bt_le_adv_start(adv_param, ad, ARRAY_SIZE(ad), sd, ARRAY_SIZE(sd));
 
 	if (err) {
@@ -92,6 +235,8 @@ static void advertising_start(void)
 		return;
 	}
 
+	advertising_set(true);
+
 	LOG_INF("Advertising successfully started");
 }
 
@@ -112,12 +257,13 @@ static void pairing_process(struct k_work *work)
 	LOG_INF("Passkey for %s: %06u", addr, pairing_data.passkey);
 	LOG_INF("Hold VOLUME UP + VOLUME DOWN simultaneously for 3 seconds to pair.");
 
-	led_blink(LED_INDEX_GREEN, K_FOREVER);
+	ui_notify(BUS_UI_PAIRING_PENDING);
 }
 
 static void connected(struct bt_conn *conn, uint8_t err)
 {
 	char addr[BT_ADDR_LE_STR_LEN];
+	struct bt_conn_info info;
 
 	bt_addr_le_to_str(bt_conn_get_dst(conn), addr, sizeof(addr));
 
@@ -128,6 +274,9 @@ static void connected(struct bt_conn *conn, uint8_t err)
 
 	LOG_INF("Connected %s", addr);
 
+	// Connectable advertising ends with the connection
+	advertising_set(false);
+
 	err = bt_hids_connected(&hids_obj, conn);
 
 	if (err) {
@@ -137,12 +286,22 @@ static void connected(struct bt_conn *conn, uint8_t err)
 
 	for (size_t i = 0; i < CONFIG_BT_HIDS_MAX_CLIENT_COUNT; i++) {
 		if (!conn_mode[i].conn) {
-			conn_mode[i].conn = conn;
-			conn_mode[i].in_boot_mode = false;
+			conn_mode[i] = (struct conn_mode) {
+				.conn = conn,
+			};
+
+			if (!bt_conn_get_info(conn, &info)) {
+				TELEMETRY_SET(conn_interval_us, info.le.interval * 1250);
+
+				conn_mode[i].energy_ua = energy_connection_ua(info.le.interval * 1250);
+				ENERGY_CHANGE(CONNECTION, 0, conn_mode[i].energy_ua);
+			}
 			break;
 		}
 	}
 
+	conn_notify(true);
+
 	for (size_t i = 0; i < CONFIG_BT_HIDS_MAX_CLIENT_COUNT; i++) {
 		if (!conn_mode[i].conn) {
 			advertising_start();
@@ -169,6 +328,8 @@ static void disconnected(struct bt_conn *conn, uint8_t reason)
 
 	for (size_t i = 0; i < CONFIG_BT_HIDS_MAX_CLIENT_COUNT; i++) {
 		if (conn_mode[i].conn == conn) {
+			ENERGY_CHANGE(CONNECTION, conn_mode[i].energy_ua, 0);
+
 			conn_mode[i].conn = NULL;
 		} else {
 			if (conn_mode[i].conn) {
@@ -177,6 +338,8 @@ static void disconnected(struct bt_conn *conn, uint8_t reason)
 		}
 	}
 
+	conn_notify(false);
+
 	advertising_start();
 }
 
@@ -194,10 +357,28 @@ static void security_changed(struct bt_conn *conn, bt_security_t level, enum bt_
 	LOG_INF("Security changed: %s level %u", addr, level);
 }
 
+static void le_param_updated(struct bt_conn *conn, uint16_t interval, uint16_t latency, uint16_t timeout)
+{
+	uint32_t energy_ua = energy_connection_ua(interval * 1250);
+
+	LOG_INF("Connection interval %u us, latency %u, timeout %u ms",
+		interval * 1250, latency, timeout * 10);
+
+	TELEMETRY_SET(conn_interval_us, interval * 1250);
+
+	for (size_t i = 0; i < CONFIG_BT_HIDS_MAX_CLIENT_COUNT; i++) {
+		if (conn_mode[i].conn == conn) {
+			ENERGY_CHANGE(CONNECTION, conn_mode[i].energy_ua, energy_ua);
+			conn_mode[i].energy_ua = energy_ua;
+		}
+	}
+}
+
 BT_CONN_CB_DEFINE(conn_callbacks) = {
 	.connected = connected,
 	.disconnected = disconnected,
 	.security_changed = security_changed,
+	.le_param_updated = le_param_updated,
 };
 
 static void hids_outp_rep_handler(struct bt_hids_rep *rep, struct bt_conn *conn, bool write)
@@ -288,11 +469,11 @@ static void hid_init(void)
 		0x95, 0x06,       /* Report Count (6) */
 		0x75, 0x08,       /* Report Size (8) */
 		0x15, 0x00,       /* Logical Minimum (0) */
-		0x25, 0x65,       /* Logical Maximum (101) */
+		0x25, KEYMAP_KEYBOARD_USAGE_MAX, /* Logical Maximum (101) */
 		
 		0x05, 0x07,       /* Usage Page (Key codes) */
 		0x19, 0x00,       /* Usage Minimum (0) */
-		0x29, 0x65,       /* Usage Maximum (101) */
+		0x29, KEYMAP_KEYBOARD_USAGE_MAX, /* Usage Maximum (101) */
 		0x81, 0x00,       /* Input (Data, Array) Key array(6 bytes) */
 
 		0x95, 0x05,       /* Report Count (5) */
@@ -315,19 +496,12 @@ static void hid_init(void)
 		0x15, 0x00,        //   Logical Minimum (0)
 		0x25, 0x01,        //   Logical Maximum (1)
 
-		0x09, 0xE2,        //   Usage (Mute)
-		0x09, 0xCD,        //   Usage (Play/Pause)
-		0x09, 0xE9,        //   Usage (Volume Increment)
-		0x09, 0xEA,        //   Usage (Volume Decrement)
+		KEYMAP_CONSUMER_USAGES(CONSUMER_USAGE_ITEM)
 
 		0x75, 0x01,        //   Report Size (1)
-		0x95, 0x04,        //   Report Count (4)
+		0x95, 0x08,        //   Report Count (8)
 		0x81, 0x02,        //   Input (Data,Var,Abs)
 
-		0x75, 0x01,        //   Report Size (1)
-		0x95, 0x04,        //   Report Count (4)
-		0x81, 0x01,        //   Input (Const,Arr,Abs) ; padding
-
 		0xC0               // End Collection
 	};
 
@@ -393,7 +567,7 @@ static void auth_passkey_confirm(struct bt_conn *conn, unsigned int passkey)
 	 * be proccess from queue after handling the earlier ones.
 	 */
 	if (k_msgq_num_used_get(&mitm_queue) == 1) {
-		k_work_submit(&pairing_work);
+		k_work_submit_to_queue(&app_workq, &pairing_work);
 	}
 }
 
@@ -414,7 +588,7 @@ static void pairing_complete(struct bt_conn *conn, bool bonded)
 
 	LOG_INF("Pairing completed: %s, bonded: %d", addr, bonded);
 	
-	led_blink(LED_INDEX_GREEN, LED_LONG_BLINK_DURATION);
+	ui_notify(BUS_UI_PAIRING_DONE);
 }
 
 static void pairing_failed(struct bt_conn *conn, enum bt_security_err reason)
@@ -436,9 +610,7 @@ static void pairing_failed(struct bt_conn *conn, enum bt_security_err reason)
 	LOG_ERR("Pairing failed conn: %s, reason %d %s",
 		    addr, reason, bt_security_err_to_str(reason));
 
-	
-	led_blink(LED_INDEX_GREEN, K_NO_WAIT);
-	led_blink(LED_INDEX_RED,   LED_LONG_BLINK_DURATION);
+	ui_notify(BUS_UI_PAIRING_FAILED);
 }
 
 static struct bt_conn_auth_cb conn_auth_callbacks = {
@@ -452,8 +624,82 @@ static struct bt_conn_auth_info_cb conn_auth_info_callbacks = {
 	.pairing_failed = pairing_failed
 };
 
-static int send_report_to_clients(uint8_t report_index, const uint8_t *data, size_t len)
+/**
+ * Queue the timestamp of a report about to be sent to a client.
+ *
+ * @returns false if too many reports of the client are in flight to time this one
+ */
+static bool report_push(struct conn_mode *mode, uint32_t timestamp_cyc)
 {
+	k_spinlock_key_t key = k_spin_lock(&report_lock);
+	bool queued = mode->report_count < REPORTS_IN_FLIGHT;
+
+	if (queued) {
+		mode->report_cyc[(mode->report_head + mode->report_count) % REPORTS_IN_FLIGHT] = timestamp_cyc;
+		++mode->report_count;
+	}
+
+	k_spin_unlock(&report_lock, key);
+
+	return queued;
+}
+
+// Take back the newest timestamp, its report was never queued
+static void report_unpush(struct conn_mode *mode)
+{
+	k_spinlock_key_t key = k_spin_lock(&report_lock);
+
+	if (mode->report_count) {
+		--mode->report_count;
+	}
+
+	k_spin_unlock(&report_lock, key);
+}
+
+// Notifications of a connection complete in the order they were queued
+static void report_sent(struct bt_conn *conn, void *user_data)
+{
+	k_spinlock_key_t key;
+	uint32_t latency;
+	int i;
+
+	ARG_UNUSED(user_data);
+
+	for (i = 0; i < CONFIG_BT_HIDS_MAX_CLIENT_COUNT; i++) {
+		struct conn_mode *mode = &conn_mode[i];
+
+		if (mode->conn != conn) {
+			continue;
+		}
+
+		key = k_spin_lock(&report_lock);
+
+		if (!mode->report_count) {
+			k_spin_unlock(&report_lock, key);
+			continue;
+		}
+
+		latency = k_cyc_to_us_floor32(k_cycle_get_32() - mode->report_cyc[mode->report_head]);
+		mode->report_head = (mode->report_head + 1) % REPORTS_IN_FLIGHT;
+		--mode->report_count;
+
+		k_spin_unlock(&report_lock, key);
+
+		TELEMETRY_SET(press_notify_last_us, latency);
+		TELEMETRY_MAX(press_notify_max_us, latency);
+
+		power_report_sent();
+	}
+}
+
+/**
+ * Reports with a timestamp are timed until the stack has sent them to
+ * each client. Runs on the HID work queue, the send may wait for a buffer.
+ */
+static int send_report_to_clients(uint8_t report_index, const uint8_t *data, size_t len,
+				  uint32_t timestamp_cyc)
+{
+	bt_gatt_complete_func_t sent;
 	int i, err;
 
 	for (i = 0; i < CONFIG_BT_HIDS_MAX_CLIENT_COUNT; i++) {
@@ -463,52 +709,107 @@ static int send_report_to_clients(uint8_t report_index, const uint8_t *data, siz
 				continue;
 			}
 
-			err = bt_hids_inp_rep_send(&hids_obj, conn_mode[i].conn, report_index, data, len, NULL);
+			APP_TRACE_EVENT("hid_send", report_index, i);
+
+			// Only reports with a queued timestamp get the callback
+			sent = (timestamp_cyc && report_push(&conn_mode[i], timestamp_cyc)) ?
+			       report_sent : NULL;
+
+			CACHE_PROF_BEGIN(HID_SEND);
+			err = bt_hids_inp_rep_send(&hids_obj, conn_mode[i].conn, report_index, data, len, sent);
+			CACHE_PROF_END(HID_SEND);
 
 			if (err) {
+				if (sent) {
+					report_unpush(&conn_mode[i]);
+				}
+
+				TELEMETRY_INC(reports_dropped);
 				LOG_ERR("Key report send error: %d", err);
 				return err;
 			}
+
+			TELEMETRY_INC(reports_sent);
 		}
 	}
 
 	return 0;
 }
 
-static int navigation_report_send(ble_hid_key_t pressed_keys)
+static void report_process(struct k_work *work)
 {
-	uint8_t data[INPUT_REPORT_KEYS_MAX_LEN] = {0};
+	queued_report_t report;
+	uint32_t latency;
 
-	if (pressed_keys & BLE_HID_KEY_VOLUME_UP) {
-		data[2] = 0x52; // up
-	}
-	
-	if (pressed_keys & BLE_HID_KEY_VOLUME_DOWN) {
-		data[3] = 0x51; // down
-	}
-	
-	if (pressed_keys & BLE_HID_KEY_PLAYPAUSE) {
-		data[4] = 0x50; // left
+	ARG_UNUSED(work);
+
+	while (!k_msgq_get(&report_queue, &report, K_NO_WAIT)) {
+		send_report_to_clients(report.index, report.data, report.len, report.timestamp_cyc);
+
+		if (!report.timestamp_cyc) {
+			continue;
+		}
+
+		latency = k_cyc_to_us_floor32(k_cycle_get_32() - report.timestamp_cyc);
+
+		TELEMETRY_SET(press_report_last_us, latency);
+		TELEMETRY_MAX(press_report_max_us, latency);
 	}
-	
-	if (pressed_keys & BLE_HID_KEY_MUTE) {
-		data[5] = 0x4f; // right
+}
+
+/**
+ * Hand a report to the HID work queue, never waits. Reports built while
+ * report_timestamp_cyc is set are timed.
+ *
+ * @returns 0 on success,
+ *          >0 if the queue is full and the report was dropped
+ */
+static int report_enqueue(uint8_t report_index, const uint8_t *data, size_t len)
+{
+	queued_report_t report = {
+		.timestamp_cyc = report_timestamp_cyc,
+		.index = report_index,
+		.len = len,
+	};
+
+	memcpy(report.data, data, len);
+
+	if (k_msgq_put(&report_queue, &report, K_NO_WAIT)) {
+		TELEMETRY_INC(reports_dropped);
+		LOG_ERR("Report queue full, dropping report");
+		return 1;
 	}
-	
-	LOG_HEXDUMP_INF(data, INPUT_REPORT_KEYS_MAX_LEN, "Navigation report data");
 
-	return send_report_to_clients(INPUT_REP_KEYS_IDX, data, sizeof(data));
+	k_work_submit_to_queue(&hid_workq, &report_work);
+
+	return 0;
 }
 
-static int media_report_send(ble_hid_key_t pressed_keys)
+/**
+ * The bits of slots are keymap slots, the keys occupy the slots
+ * at their own bit position.
+ */
+static int navigation_report_send(uint32_t slots)
 {
-	uint8_t data[INPUT_REPORT_CONSUMER_MAX_LEN];
+	uint8_t data[INPUT_REPORT_KEYS_MAX_LEN] = {0};
 
-	data[0] = pressed_keys;
+	// Keys follow the modifiers and the reserved byte
+	keymap_navigation_keys(slots, &data[2], sizeof(data) - 2);
 	
-	LOG_HEXDUMP_INF(data, INPUT_REPORT_CONSUMER_MAX_LEN, "Media controls report");
+	APP_TRACE_HEXDUMP(data, INPUT_REPORT_KEYS_MAX_LEN, "Navigation report data");
 
-	return send_report_to_clients(INPUT_REP_CONSUMER_IDX, data, sizeof(data));
+	return report_enqueue(INPUT_REP_KEYS_IDX, data, sizeof(data));
+}
+
+static int media_report_send(uint32_t slots)
+{
+	uint8_t data[INPUT_REPORT_CONSUMER_MAX_LEN] = {
+		keymap_media_bits(slots),
+	};
+	
+	APP_TRACE_HEXDUMP(data, INPUT_REPORT_CONSUMER_MAX_LEN, "Media controls report");
+
+	return report_enqueue(INPUT_REP_CONSUMER_IDX, data, sizeof(data));
 }
 
 static void num_comp_reply(bool accept)
@@ -533,63 +834,97 @@ static void num_comp_reply(bool accept)
 	bt_conn_unref(pairing_data.conn);
 
 	if (k_msgq_num_used_get(&mitm_queue)) {
-		k_work_submit(&pairing_work);
+		k_work_submit_to_queue(&app_workq, &pairing_work);
 	}
 }
 
-static void input_thread(void)
+/**
+ * Press and release a gesture slot, keys which are down stay pressed.
+ */
+static void gesture_slot_report(keymap_slot_t slot)
 {
-    ble_key_input_t input;
-	k_timeout_t timeout = K_FOREVER;
 	int err;
 
-    while (true) {
-        err = k_msgq_get(&input_queue, &input, timeout);
+	if (keymap_get(alt_mode ? KEYMAP_MODE_NAVIGATION : KEYMAP_MODE_MEDIA, slot) == 0) {
+		return;
+	}
 
-		timeout = K_FOREVER;
+	if (alt_mode) {
+		err = navigation_report_send(reported_mask | BIT(slot)) | navigation_report_send(reported_mask);
+	} else {
+		err = media_report_send(reported_mask | BIT(slot)) | media_report_send(reported_mask);
+	}
 
-		if (err == -EAGAIN) {
-			if (input.pressed_mask == BLE_HID_KEY_MUTE) {
-				LOG_WRN("Switch to %s mode", alt_mode ? "media" : "nav");
+	reported_known = reported_known && !err;
+}
 
-				alt_mode ^= 1;
+static void gesture_recognized(gesture_engine_t *engine, const gesture_def_t *gesture)
+{
+	ARG_UNUSED(engine);
 
-				navigation_report_send(0);
-				media_report_send(0);
+	if (gesture->action >= GESTURE_ACTION_SLOT) {
+		gesture_slot_report(gesture->action - GESTURE_ACTION_SLOT);
+		return;
+	}
 
-				led_blink(LED_INDEX_GREEN, LED_SHORT_BLINK_DURATION);
-			} else {
-				LOG_WRN("Accept pairing");
+	switch (gesture->action) {
+	case GESTURE_ACTION_MODE_SWITCH:
+		LOG_WRN("Switch to %s mode", alt_mode ? "media" : "nav");
 
-				if (k_msgq_num_used_get(&mitm_queue)) {
-					num_comp_reply(true);
-				}
-			}
-			continue;
-		}
+		alt_mode ^= 1;
 
-		if (input.pressed_mask == (BLE_HID_KEY_VOLUME_UP | BLE_HID_KEY_VOLUME_DOWN)) {
-			timeout = K_SECONDS(3);
-			continue;
-		}
+		reported_mask = 0;
+		reported_known = !(navigation_report_send(0) | media_report_send(0));
 
-		if (input.pressed_mask == BLE_HID_KEY_MUTE) {
-			timeout = K_SECONDS(3);
-			LOG_ERR("Await timeout");
-		}
+		ui_notify(BUS_UI_MODE_SWITCH);
+		break;
+	case GESTURE_ACTION_PAIRING_ACCEPT:
+		LOG_WRN("Accept pairing");
 
-		if (alt_mode) {
-			navigation_report_send(input.pressed_mask);
-		} else {
-			media_report_send(input.pressed_mask);
+		if (k_msgq_num_used_get(&mitm_queue)) {
+			num_comp_reply(true);
 		}
-    }
+		break;
+	}
+}
+
+static void gesture_schedule(uint32_t next)
+{
+	int32_t delay = next - k_uptime_get_32();
+
+	if (next == GESTURE_NO_DEADLINE) {
+		k_work_cancel_delayable(&gesture_work);
+		return;
+	}
+
+	k_work_reschedule_for_queue(&app_workq, &gesture_work, K_MSEC(MAX(delay, 0)));
+}
+
+static void gesture_process(struct k_work *work)
+{
+	ARG_UNUSED(work);
+
+	gesture_schedule(gesture_tick(&gestures, k_uptime_get_32()));
 }
 
 int ble_init(void)
 {
 	int err;
 
+	// Touches are handled even if Bluetooth fails to come up
+	k_work_init_delayable(&gesture_work, gesture_process);
+	k_work_init(&report_work, report_process);
+
+	health_watch_msgq("mitm", &mitm_queue);
+	health_watch_msgq("report", &report_queue);
+
+	err = gesture_init(&gestures, gesture_table, ARRAY_SIZE(gesture_table), gesture_recognized, NULL);
+
+	if (err) {
+		LOG_ERR("Invalid gesture table, err %d", err);
+		return err;
+	}
+
 	err = bt_conn_auth_cb_register(&conn_auth_callbacks);
 
 	if (err) {
@@ -626,9 +961,242 @@ int ble_init(void)
 	return 0;
 }
 
-void ble_send_key_input(const ble_key_input_t *input)
+void ble_suspend(void)
+{
+	int err;
+
+	suspended = true;
+
+	err = bt_le_adv_stop();
+
+	if (err) {
+		LOG_ERR("Failed to stop advertising, err %d", err);
+	}
+
+	advertising_set(false);
+}
+
+void ble_resume(void)
+{
+	suspended = false;
+
+	advertising_start();
+}
+
+static void keys_report(ble_hid_key_t pressed_mask, uint32_t timestamp_cyc)
+{
+	int err;
+
+	// The host already has this state, skip the report
+	if (reported_known && pressed_mask == reported_mask) {
+		TELEMETRY_INC(reports_coalesced);
+		return;
+	}
+
+	report_timestamp_cyc = timestamp_cyc;
+
+	if (alt_mode) {
+		err = navigation_report_send(pressed_mask);
+	} else {
+		err = media_report_send(pressed_mask);
+	}
+
+	report_timestamp_cyc = 0;
+
+	// A dropped report leaves the host at the state it had, the next one is sent regardless
+	if (!err) {
+		reported_mask = pressed_mask;
+		reported_known = true;
+	}
+}
+
+#if CONFIG_APP_SLIDE
+static uint32_t uptime_us(void)
+{
+	return (uint32_t)k_ticks_to_us_floor64(k_uptime_ticks());
+}
+
+/**
+ * Hold back the reports of a new touch until the end of a scan has told a
+ * key press from a slide or a swipe, see keys_release_held().
+ *
+ * @returns true if the mask must not be reported now
+ */
+static bool keys_hold(ble_hid_key_t pressed_mask, uint32_t timestamp_cyc)
+{
+	// The pads under a sliding finger are not key presses
+	if (sliding) {
+		return true;
+	}
+
+	// The slide detector may not have seen a finger which was only just detected
+	if (!holding && (pressed_mask & ~reported_mask) &&
+	    (!slide.touching || slide_undecided(&slide, uptime_us()))) {
+		holding = true;
+		held_mask = reported_mask;
+		held_tap = 0;
+		held_cyc = timestamp_cyc;
+	}
+
+	if (!holding) {
+		return false;
+	}
+
+	if (!pressed_mask && held_mask) {
+		held_tap = held_mask;
+	}
+
+	held_mask = pressed_mask;
+
+	return true;
+}
+
+/**
+ * Report what was held back, a tap which already ended as a press and release.
+ */
+static void keys_release_held(void)
+{
+	holding = false;
+
+	if (held_tap && held_tap != held_mask) {
+		keys_report(held_tap, held_cyc);
+	}
+
+	keys_report(held_mask, held_cyc);
+}
+#endif
+
+// Called from the scan on the application work queue, like gesture_process()
+static void touch_listener(const struct zbus_channel *chan)
+{
+	const bus_touch_msg_t *touch = zbus_chan_const_msg(chan);
+	ble_hid_key_t pressed_mask = touch->pressed_mask;
+
+	gesture_input(&gestures, pressed_mask, touch->timestamp_ms);
+	gesture_schedule(gesture_tick(&gestures, k_uptime_get_32()));
+
+	// The pairing chord is not meant for the host
+	if (pressed_mask == (BLE_HID_KEY_VOLUME_UP | BLE_HID_KEY_VOLUME_DOWN)) {
+		return;
+	}
+
+#if CONFIG_APP_SLIDE
+	if (keys_hold(pressed_mask, touch->timestamp_cyc)) {
+		return;
+	}
+#endif
+
+	keys_report(pressed_mask, touch->timestamp_cyc);
+}
+
+ZBUS_LISTENER_DEFINE(ble_touch_lis, touch_listener);
+ZBUS_CHAN_ADD_OBS(bus_touch_chan, ble_touch_lis, 0);
+
+static void tune_listener(const struct zbus_channel *chan)
+{
+	const bus_tune_msg_t *tune = zbus_chan_const_msg(chan);
+	struct bt_le_conn_param param = {
+		.interval_min = tune->value,
+		.interval_max = tune->value,
+		.latency = 0,
+		.timeout = 400,
+	};
+	int i, err;
+
+	if (tune->param != BUS_TUNE_CONN_INTERVAL) {
+		return;
+	}
+
+	for (i = 0; i < CONFIG_BT_HIDS_MAX_CLIENT_COUNT; i++) {
+		if (!conn_mode[i].conn) {
+			continue;
+		}
+
+		// The central decides, le_param_updated reports what it picked
+		err = bt_conn_le_param_update(conn_mode[i].conn, &param);
+
+		if (err) {
+			LOG_WRN("Connection parameter update failed, err %d", err);
+		}
+	}
+}
+
+ZBUS_LISTENER_DEFINE(ble_tune_lis, tune_listener);
+ZBUS_CHAN_ADD_OBS(bus_tune_chan, ble_tune_lis, 1);
+
+#if CONFIG_APP_SLIDE
+static void slide_report(int8_t direction, int steps)
 {
-    k_msgq_put(&input_queue, input, K_NO_WAIT);
+	uint32_t slot = BIT((direction > 0) ? KEYMAP_SLOT_SLIDE_UP : KEYMAP_SLOT_SLIDE_DOWN);
+	int i, err = 0;
+
+	// Each step is a separate press and release
+	for (i = 0; i < steps; ++i) {
+		if (alt_mode) {
+			err = navigation_report_send(slot) | navigation_report_send(0);
+		} else {
+			err = media_report_send(slot) | media_report_send(0);
+		}
+	}
+
+	// Only the last release tells what the host has now
+	reported_mask = 0;
+	reported_known = !err;
+}
+
+// Called for every sample of the scan, on the application work queue
+static void pad_raw_listener(const struct zbus_channel *chan)
+{
+	const bus_pad_raw_msg_t *raw = zbus_chan_const_msg(chan);
+	slide_event_t event;
+	uint32_t latency;
+
+	if (slide.pad_count != raw->pad_count && slide_init(&slide, raw->pad_count)) {
+		return;
+	}
+
+	slide_sample(&slide, raw->pad, raw->value, raw->threshold);
+
+	if (raw->pad != raw->pad_count - 1) {
+		return;
+	}
+
+	switch (slide_scan_end(&slide, uptime_us(), &event)) {
+	case SLIDE_EVENT_NONE:
+		// A finger which rested long enough or lifted without a swipe pressed keys
+		if (holding && !slide_undecided(&slide, uptime_us())) {
+			keys_release_held();
+		}
+		return;
+	case SLIDE_EVENT_STEP:
+		if (!sliding) {
+			// Release whatever the pads under the finger reported so far
+			sliding = true;
+			holding = false;
+			navigation_report_send(0);
+			media_report_send(0);
+		}
+
+		slide_report(event.direction, 1);
+		TELEMETRY_INC(slide_steps);
+		break;
+	case SLIDE_EVENT_SWIPE:
+		// The pads under the swipe were never reported
+		holding = false;
+		slide_report(event.direction, CONFIG_APP_SLIDE_SWIPE_STEPS);
+		TELEMETRY_INC(swipes);
+		break;
+	case SLIDE_EVENT_END:
+		sliding = false;
+		return;
+	}
+
+	latency = uptime_us() - event.end_us;
+
+	TELEMETRY_SET(slide_report_last_us, latency);
+	TELEMETRY_MAX(slide_report_max_us, latency);
 }
 
-K_THREAD_DEFINE(input_thread_id, 2048, input_thread, NULL, NULL, NULL, 14, 0, 0);
+ZBUS_LISTENER_DEFINE(ble_pad_raw_lis, pad_raw_listener);
+ZBUS_CHAN_ADD_OBS(bus_pad_raw_chan, ble_pad_raw_lis, 1);
+#endif
@@ -11,7 +11,8 @@
 /**
  * Keyboard key index.
  * 
- * The positions of these bits must match their positions in the HID report (see ble.c).
+ * The bit positions are the keymap slots of the keys (see keymap.h),
+ * the names are their usages in the default media keymap.
  */
 typedef enum {
     BLE_HID_KEY_MUTE        = (1 << 0),
@@ -20,16 +21,6 @@ typedef enum {
     BLE_HID_KEY_VOLUME_DOWN = (1 << 3),
 } ble_hid_key_t;
 
-/**
- * Message which indicates which key was most recently pressed/released,
- * and the mask of all currently pressed keys.
- */
-typedef struct {
-    int button;
-    bool button_pressed;
-    ble_hid_key_t pressed_mask;
-} ble_key_input_t;
-
 /**
  * Initialize the Bluetooth subsystem + keyboard HIDS.
  * 
@@ -39,9 +30,11 @@ typedef struct {
 int ble_init(void);
 
 /**
- * Send the updated key input to all connected clients.
- * 
- * @param input An input object with the latest pressed/released
- *              key and a map of all currently pressed keys.
+ * Stop advertising until ble_resume() is called.
+ */
+void ble_suspend(void);
+
+/**
+ * Resume advertising after ble_suspend().
  */
-void ble_send_key_input(const ble_key_input_t *input);
+void ble_resume(void);
@@ -0,0 +1,66 @@
+/**
+ * @file    bus.c
+ * @author  Matthijs Bakker
+ * @date    2026-10-18
+ * @brief   Typed event channels between the application modules
+ */
+
+#include "bus.h"
+
+#include <zephyr/logging/log.h>
+
+#define BUS_PUBLISH_TIMEOUT         K_MSEC(10)
+
+static bus_stats_t touch_stats;
+static bus_stats_t pad_raw_stats;
+static bus_stats_t conn_stats;
+static bus_stats_t ui_stats;
+static bus_stats_t tune_stats;
+
+// Observers attach themselves with ZBUS_CHAN_ADD_OBS() in their own module
+
+ZBUS_CHAN_DEFINE(bus_touch_chan, bus_touch_msg_t, NULL, &touch_stats,
+		 ZBUS_OBSERVERS_EMPTY, ZBUS_MSG_INIT(0));
+
+ZBUS_CHAN_DEFINE(bus_pad_raw_chan, bus_pad_raw_msg_t, NULL, &pad_raw_stats,
+		 ZBUS_OBSERVERS_EMPTY, ZBUS_MSG_INIT(0));
+
+ZBUS_CHAN_DEFINE(bus_conn_chan, bus_conn_msg_t, NULL, &conn_stats,
+		 ZBUS_OBSERVERS_EMPTY, ZBUS_MSG_INIT(0));
+
+ZBUS_CHAN_DEFINE(bus_ui_chan, bus_ui_msg_t, NULL, &ui_stats,
+		 ZBUS_OBSERVERS_EMPTY, ZBUS_MSG_INIT(0));
+
+ZBUS_CHAN_DEFINE(bus_tune_chan, bus_tune_msg_t, NULL, &tune_stats,
+		 ZBUS_OBSERVERS_EMPTY, ZBUS_MSG_INIT(0));
+
+LOG_MODULE_REGISTER(bus);
+
+int bus_publish(const struct zbus_channel *chan, const void *msg)
+{
+	bus_stats_t *stats = zbus_chan_user_data(chan);
+	uint32_t start = k_cycle_get_32();
+	uint32_t latency;
+	int err;
+
+	err = zbus_chan_pub(chan, msg, k_is_in_isr() ? K_NO_WAIT : BUS_PUBLISH_TIMEOUT);
+
+	if (err) {
+		atomic_inc(&stats->drops);
+		LOG_WRN("Dropped message, err %d", err);
+		return 1;
+	}
+
+	latency = k_cyc_to_us_floor32(k_cycle_get_32() - start);
+
+	atomic_inc(&stats->publishes);
+	stats->latency_last_us = latency;
+	stats->latency_max_us = MAX(stats->latency_max_us, latency);
+
+	return 0;
+}
+
+const bus_stats_t *bus_stats(const struct zbus_channel *chan)
+{
+	return zbus_chan_user_data(chan);
+}
@@ -0,0 +1,109 @@
+/**
+ * @file    bus.h
+ * @author  Matthijs Bakker
+ * @date    2026-10-18
+ * @brief   Typed event channels between the application modules
+ *
+ * Channels are zbus channels with synchronous listeners. A listener reads
+ * the latest message in place with zbus_chan_const_msg() and must not
+ * block, it runs in the context of the publisher.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/zbus/zbus.h>
+
+/**
+ * A debounced touchpad changed state.
+ */
+typedef struct {
+	uint8_t pad;
+	bool pressed;
+	uint32_t key;               // emulated key of the pad
+	uint32_t pressed_mask;      // all currently pressed keys
+	uint32_t timestamp_ms;
+	uint32_t timestamp_cyc;     // cycle counter when the change was accepted
+} bus_touch_msg_t;
+
+/**
+ * A calibrated sample of a single touchpad.
+ */
+typedef struct {
+	uint8_t pad;
+	uint8_t pad_count;          // the scan is complete after pad_count - 1
+	uint32_t value;
+	uint32_t threshold;
+} bus_pad_raw_msg_t;
+
+/**
+ * A BLE client connected or disconnected.
+ */
+typedef struct {
+	bool connected;
+	uint8_t connections;        // number of clients after the change
+} bus_conn_msg_t;
+
+typedef enum {
+	BUS_UI_READY,
+	BUS_UI_PAIRING_PENDING,
+	BUS_UI_PAIRING_DONE,
+	BUS_UI_PAIRING_FAILED,
+	BUS_UI_MODE_SWITCH,
+	BUS_UI_SLEEP,
+} bus_ui_event_t;
+
+/**
+ * Something the user should be notified of.
+ */
+typedef struct {
+	bus_ui_event_t event;
+} bus_ui_msg_t;
+
+typedef enum {
+	BUS_TUNE_THRESHOLD,         // touch threshold in percent of the baseline
+	BUS_TUNE_DEBOUNCE,          // scans a state change must persist
+	BUS_TUNE_OVERSAMPLING,      // samples averaged per pad per scan
+	BUS_TUNE_SCAN_PERIOD,       // milliseconds between scans
+	BUS_TUNE_CONN_INTERVAL,     // connection interval in units of 1.25 ms
+} bus_tune_param_t;
+
+/**
+ * A detection parameter changed at runtime. Only published from the
+ * application work queue, so the scan never sees a half applied change.
+ */
+typedef struct {
+	bus_tune_param_t param;
+	uint8_t pad;                // only for per pad parameters
+	uint32_t value;
+} bus_tune_msg_t;
+
+/**
+ * Per channel counters, stored as the user data of the channel.
+ */
+typedef struct {
+	atomic_t publishes;
+	atomic_t drops;
+	uint32_t latency_last_us;   // time spent notifying all listeners
+	uint32_t latency_max_us;
+} bus_stats_t;
+
+ZBUS_CHAN_DECLARE(bus_touch_chan, bus_pad_raw_chan, bus_conn_chan, bus_ui_chan, bus_tune_chan);
+
+/**
+ * Publish a message and notify all listeners of the channel.
+ *
+ * Waits shortly for the channel when called from a thread, never waits
+ * when called from an ISR. A message which cannot be published is counted
+ * as dropped.
+ *
+ * @returns 0 on success,
+ *          >0 if the message was dropped
+ */
+int bus_publish(const struct zbus_channel *chan, const void *msg);
+
+/**
+ * Counters of a channel.
+ */
+const bus_stats_t *bus_stats(const struct zbus_channel *chan);
@@ -0,0 +1,76 @@
+/**
+ * @file    cache_prof.c
+ * @author  Matthijs Bakker
+ * @date    2026-10-18
+ * @brief   Instruction cache hit and miss counts of code regions
+ */
+
+#include "cache_prof.h"
+#include "telemetry.h"
+
+#include <zephyr/kernel.h>
+
+#if !CONFIG_ARCH_POSIX
+#include <hal/nrf_cache.h>
+#endif
+
+// The hardware counters are 32-bit, a region is short enough to wrap at most once
+typedef struct {
+	uint32_t instruction_hits;
+	uint32_t instruction_misses;
+	uint32_t data_hits;
+	uint32_t data_misses;
+} cache_prof_counters_t;
+
+static cache_prof_counters_t snapshots[__TELEMETRY_CACHE_MAX];
+
+static void counters_read(cache_prof_counters_t *counters)
+{
+#if CONFIG_ARCH_POSIX
+	*counters = (cache_prof_counters_t) {0};
+#else
+	counters->instruction_hits = nrf_cache_instruction_hit_counter_get(NRF_CACHE);
+	counters->instruction_misses = nrf_cache_instruction_miss_counter_get(NRF_CACHE);
+	counters->data_hits = nrf_cache_data_hit_counter_get(NRF_CACHE);
+	counters->data_misses = nrf_cache_data_miss_counter_get(NRF_CACHE);
+#endif
+}
+
+void cache_prof_begin(unsigned int region)
+{
+	if (region < __TELEMETRY_CACHE_MAX) {
+		counters_read(&snapshots[region]);
+	}
+}
+
+void cache_prof_end(unsigned int region)
+{
+	const cache_prof_counters_t *start;
+	telemetry_cache_t *data;
+	cache_prof_counters_t now;
+
+	if (region >= __TELEMETRY_CACHE_MAX) {
+		return;
+	}
+
+	counters_read(&now);
+
+	start = &snapshots[region];
+	data = &telemetry.cache[region];
+
+	data->instruction_hits += (uint32_t)(now.instruction_hits - start->instruction_hits);
+	data->instruction_misses += (uint32_t)(now.instruction_misses - start->instruction_misses);
+	data->data_hits += (uint32_t)(now.data_hits - start->data_hits);
+	data->data_misses += (uint32_t)(now.data_misses - start->data_misses);
+	++data->runs;
+}
+
+int cache_prof_init(void)
+{
+#if !CONFIG_ARCH_POSIX
+	nrf_cache_profiling_counters_clear(NRF_CACHE);
+	nrf_cache_profiling_set(NRF_CACHE, true);
+#endif
+
+	return 0;
+}
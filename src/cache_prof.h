@@ -0,0 +1,50 @@
+/**
+ * @file    cache_prof.h
+ * @author  Matthijs Bakker
+ * @date    2026-10-18
+ * @brief   Instruction cache hit and miss counts of code regions
+ *
+ * The cache of the application core counts hits and misses globally. A
+ * region takes a snapshot of the counters when it begins and adds the
+ * difference to its telemetry when it ends, so the counts include whatever
+ * preempted the region in between. Regions must not nest with themselves.
+ *
+ * Without CONFIG_APP_CACHE_PROF, the markers compile to nothing. On
+ * native_sim there is no cache and all counts stay zero.
+ */
+
+#include <stdint.h>
+
+#include "telemetry.h"
+
+#if CONFIG_APP_CACHE_PROF
+
+#define CACHE_PROF_BEGIN(region)    cache_prof_begin(TELEMETRY_CACHE_ ## region)
+#define CACHE_PROF_END(region)      cache_prof_end(TELEMETRY_CACHE_ ## region)
+
+/**
+ * Start counting the cache profiling counters.
+ *
+ * @returns 0 on success,
+ *          >0 on failure
+ */
+int cache_prof_init(void);
+
+/**
+ * Snapshot the counters at the start of a region, use CACHE_PROF_BEGIN().
+ */
+void cache_prof_begin(unsigned int region);
+
+/**
+ * Add the counts since the snapshot to the region, use CACHE_PROF_END().
+ */
+void cache_prof_end(unsigned int region);
+
+#else
+
+#define CACHE_PROF_BEGIN(region)    ((void)0)
+#define CACHE_PROF_END(region)      ((void)0)
+
+static inline int cache_prof_init(void) { return 0; }
+
+#endif
@@ -0,0 +1,95 @@
+/**
+ * @file    clock_gov.c
+ * @author  Matthijs Bakker
+ * @date    2026-10-18
+ * @brief   128 MHz bursts of the application core clock
+ *
+ * The HFCLK divider takes effect right away. It is switched through nrfx,
+ * which applies the erratum workaround of the nRF5340 and keeps
+ * SystemCoreClock, and with it the nrfx busy waits, in step. The time
+ * spent at each frequency is accounted in kernel ticks on every switch
+ * and published to the telemetry in milliseconds.
+ */
+
+#include "clock_gov.h"
+#include "telemetry.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include <nrfx_clock.h>
+
+static struct k_spinlock gov_lock;
+static uint32_t boosts;
+static int64_t switched_at;
+static int64_t boosted_ticks;
+static int64_t base_ticks;
+
+LOG_MODULE_REGISTER(clock_gov);
+
+// Must be called with gov_lock held
+static void divider_set(nrf_clock_hfclk_div_t div)
+{
+	// Only fails for a divider the domain does not have
+	(void)nrfx_clock_divider_set(NRF_CLOCK_DOMAIN_HFCLK, div);
+}
+
+// Must be called with gov_lock held, before the divider changes
+static void account(bool boosted)
+{
+	int64_t now = k_uptime_ticks();
+
+	if (boosted) {
+		boosted_ticks += now - switched_at;
+		TELEMETRY_SET(clock_boosted_ms, (uint32_t)k_ticks_to_ms_floor64(boosted_ticks));
+	} else {
+		base_ticks += now - switched_at;
+		TELEMETRY_SET(clock_base_ms, (uint32_t)k_ticks_to_ms_floor64(base_ticks));
+	}
+
+	switched_at = now;
+}
+
+void clock_gov_boost(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&gov_lock);
+
+	if (boosts++ == 0) {
+		account(false);
+		divider_set(NRF_CLOCK_HFCLK_DIV_1);
+		TELEMETRY_INC(clock_boosts);
+	}
+
+	k_spin_unlock(&gov_lock, key);
+}
+
+void clock_gov_release(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&gov_lock);
+
+	if (boosts && --boosts == 0) {
+		account(true);
+		divider_set(NRF_CLOCK_HFCLK_DIV_2);
+	}
+
+	k_spin_unlock(&gov_lock, key);
+}
+
+int clock_gov_init(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&gov_lock);
+
+	// Everything before this ran at the boot default of 128 MHz
+	switched_at = k_uptime_ticks();
+	boosted_ticks = switched_at;
+
+	if (!boosts) {
+		divider_set(NRF_CLOCK_HFCLK_DIV_2);
+	}
+
+	k_spin_unlock(&gov_lock, key);
+
+	LOG_INF("Core clock at 64 MHz, 128 MHz while boosted");
+
+	return 0;
+}
@@ -0,0 +1,38 @@
+/**
+ * @file    clock_gov.h
+ * @author  Matthijs Bakker
+ * @date    2026-10-18
+ * @brief   128 MHz bursts of the application core clock
+ *
+ * The application core runs at 64 MHz, and at 128 MHz while at least one
+ * user holds a boost. Boosts are counted, so they may overlap and come
+ * from any context, including interrupts.
+ */
+
+#if CONFIG_APP_CLOCK_GOV
+
+/**
+ * Drop the core clock to 64 MHz and start accounting the time per frequency.
+ *
+ * @returns 0 on success,
+ *          >0 on failure
+ */
+int clock_gov_init(void);
+
+/**
+ * Run at 128 MHz until the matching clock_gov_release().
+ */
+void clock_gov_boost(void);
+
+/**
+ * Give up a boost, the clock drops back to 64 MHz with the last one.
+ */
+void clock_gov_release(void);
+
+#else
+
+static inline int clock_gov_init(void) { return 0; }
+static inline void clock_gov_boost(void) {}
+static inline void clock_gov_release(void) {}
+
+#endif
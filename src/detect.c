@@ -0,0 +1,117 @@
+/**
+ * @file    detect.c
+ * @author  Matthijs Bakker
+ * @date    2026-10-18
+ * @brief   Touch detection from raw pad samples
+ */
+
+#include "detect.h"
+
+static void apply_baseline(const detect_t *detect, detect_pad_t *data, uint32_t baseline)
+{
+	data->baseline = baseline;
+	data->threshold = baseline * detect->config.threshold_ratio;
+
+	if (data->threshold > DETECT_MAX_VALID) {
+		data->threshold = DETECT_FALLBACK_THRESHOLD;
+	}
+}
+
+int detect_init(detect_t *detect, const detect_config_t *config, uint8_t pad_count)
+{
+	if (pad_count > DETECT_MAX_PADS || !config->calibration_runs) {
+		return 1;
+	}
+
+	*detect = (detect_t) {
+		.config = *config,
+		.pad_count = pad_count,
+		.calibration_remaining = config->calibration_runs,
+	};
+
+	return 0;
+}
+
+void detect_configure(detect_t *detect, const detect_config_t *config)
+{
+	uint8_t runs = detect->config.calibration_runs;
+	uint8_t i;
+
+	detect->config = *config;
+
+	// The running calibration divides by the number of runs it started with
+	if (detect->calibration_remaining) {
+		detect->config.calibration_runs = runs;
+		return;
+	}
+
+	for (i = 0; i < detect->pad_count; ++i) {
+		apply_baseline(detect, &detect->pads[i], detect->pads[i].baseline);
+	}
+}
+
+void detect_set_baselines(detect_t *detect, const uint32_t *baselines)
+{
+	uint8_t i;
+
+	for (i = 0; i < detect->pad_count; ++i) {
+		apply_baseline(detect, &detect->pads[i], baselines[i]);
+	}
+
+	detect->calibration_remaining = 0;
+}
+
+bool detect_valid(uint32_t value)
+{
+	return value >= DETECT_MIN_VALID && value <= DETECT_MAX_VALID;
+}
+
+detect_event_t detect_sample(detect_t *detect, uint8_t pad, uint32_t value)
+{
+	detect_pad_t *data;
+	bool touch_detected;
+
+	if (pad >= detect->pad_count) {
+		return DETECT_EVENT_NONE;
+	}
+
+	data = &detect->pads[pad];
+
+	if (detect->calibration_remaining) {
+		data->threshold += value;
+		return DETECT_EVENT_NONE;
+	}
+
+	touch_detected = (value > data->threshold);
+
+	if (data->pressed == touch_detected) {
+		data->debouncing_streak = 0;
+		return DETECT_EVENT_NONE;
+	}
+
+	if (++data->debouncing_streak <= detect->config.debounce) {
+		return DETECT_EVENT_NONE;
+	}
+
+	data->debouncing_streak = 0;
+	data->pressed = touch_detected;
+
+	return touch_detected ? DETECT_EVENT_PRESS : DETECT_EVENT_RELEASE;
+}
+
+bool detect_scan_end(detect_t *detect)
+{
+	uint8_t i;
+
+	if (!detect->calibration_remaining || --detect->calibration_remaining) {
+		return false;
+	}
+
+	// We just finished the last calibration round.
+	// Calculate the arithmetic mean of the measured values.
+	for (i = 0; i < detect->pad_count; ++i) {
+		apply_baseline(detect, &detect->pads[i], detect->pads[i].threshold / detect->config.calibration_runs);
+	}
+
+	return true;
+}
@@ -0,0 +1,95 @@
+/**
+ * @file    detect.h
+ * @author  Matthijs Bakker
+ * @date    2026-10-18
+ * @brief   Touch detection from raw pad samples
+ *
+ * The first scans after boot calibrate the baseline of every pad, after
+ * which a pad is touched while its samples exceed the baseline by the
+ * threshold ratio. A state change is only accepted after it has been seen
+ * in more than debounce consecutive scans.
+ *
+ * Plain C without Zephyr dependencies, so that recordings can be replayed
+ * through the same code on the host.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define DETECT_MAX_PADS             8
+#define DETECT_MIN_VALID            20
+#define DETECT_MAX_VALID            2000
+#define DETECT_FALLBACK_THRESHOLD   250
+
+#define DETECT_CONFIG_DEFAULT \
+	{ \
+		.calibration_runs = 8, \
+		.threshold_ratio = 1.7, \
+		.debounce = 4, \
+	}
+
+typedef enum {
+	DETECT_EVENT_NONE,
+	DETECT_EVENT_PRESS,
+	DETECT_EVENT_RELEASE,
+} detect_event_t;
+
+typedef struct {
+	uint8_t calibration_runs;
+	double threshold_ratio;     // touch threshold relative to the baseline
+	uint8_t debounce;
+} detect_config_t;
+
+typedef struct {
+	uint32_t baseline;
+	uint32_t threshold;         // sum of the samples while calibrating
+	uint8_t debouncing_streak;
+	bool pressed;
+} detect_pad_t;
+
+typedef struct {
+	detect_config_t config;
+	uint8_t pad_count;
+	uint8_t calibration_remaining;
+	detect_pad_t pads[DETECT_MAX_PADS];
+} detect_t;
+
+/**
+ * Reset the detector and start calibrating pad_count pads.
+ *
+ * @returns 0 on success,
+ *          >0 if there are too many pads or the configuration is invalid
+ */
+int detect_init(detect_t *detect, const detect_config_t *config, uint8_t pad_count);
+
+/**
+ * Change the configuration. Thresholds of a calibrated detector are
+ * derived again from the baselines, a new number of calibration runs
+ * only applies to the next calibration.
+ */
+void detect_configure(detect_t *detect, const detect_config_t *config);
+
+/**
+ * Skip the calibration and derive the thresholds from known baselines,
+ * one per pad.
+ */
+void detect_set_baselines(detect_t *detect, const uint32_t *baselines);
+
+/**
+ * Check whether a sample is within the range of a working pad.
+ */
+bool detect_valid(uint32_t value);
+
+/**
+ * Feed the sample of a single pad in the current scan.
+ *
+ * @returns the accepted state change of the pad, if any
+ */
+detect_event_t detect_sample(detect_t *detect, uint8_t pad, uint32_t value);
+
+/**
+ * Finish a scan over all pads.
+ *
+ * @returns true if this scan completed the calibration
+ */
+bool detect_scan_end(detect_t *detect);
@@ -0,0 +1,150 @@
+/**
+ * @file    energy.c
+ * @author  Matthijs Bakker
+ * @date    2026-10-18
+ * @brief   Estimated charge drawn per subsystem
+ *
+ * Charge is accumulated in pC (uA times us), which does not overflow in
+ * the lifetime of a coin cell, and published in nAh.
+ *
+ * The radio runs on the network core, out of sight of this one. Its on-time
+ * is estimated from the time spent advertising or connected, the interval
+ * of those events and the radio time per event from Kconfig. Every
+ * connection is switched on with the current of its own interval.
+ *
+ * Switching a consumer on or off only adds up its charge so far, the totals
+ * are computed by energy_publish() when the telemetry is read.
+ *
+ * All time comes from now_us(). On native_sim the kernel clock is simulated,
+ * so a run of the twin with --no-rt gives the same figures every time.
+ */
+
+#include "energy.h"
+#include "telemetry.h"
+
+#include <zephyr/kernel.h>
+
+#define PC_PER_NAH                  3600000ULL  // 1 nAh = 3.6 uC
+
+typedef struct {
+	uint32_t current_ua;        // of all instances switched on
+	uint64_t since_us;
+	uint64_t charge_pc;
+} energy_consumer_t;
+
+static energy_consumer_t consumers[__TELEMETRY_ENERGY_MAX];
+static struct k_spinlock energy_lock;
+static uint64_t started_us;
+
+static uint64_t now_us(void)
+{
+	return k_ticks_to_us_floor64(k_uptime_ticks());
+}
+
+// Current of a single instance, averaged over its on-time
+static uint32_t current_ua(unsigned int consumer)
+{
+	switch (consumer) {
+		case TELEMETRY_ENERGY_SCAN:
+			return CONFIG_APP_ENERGY_SCAN_UA;
+		case TELEMETRY_ENERGY_SENSE:
+			return CONFIG_APP_ENERGY_SENSE_UA;
+		case TELEMETRY_ENERGY_LED:
+			return CONFIG_APP_ENERGY_LED_UA;
+		case TELEMETRY_ENERGY_ADVERTISING:
+			return (uint64_t)CONFIG_APP_ENERGY_RADIO_UA * CONFIG_APP_ENERGY_ADV_EVENT_US /
+			       (CONFIG_APP_ENERGY_ADV_INTERVAL_MS * 1000);
+		default:
+			return 0;
+	}
+}
+
+// Must be called with energy_lock held
+static void account(unsigned int consumer, uint64_t now)
+{
+	energy_consumer_t *data = &consumers[consumer];
+
+	data->charge_pc += (uint64_t)data->current_ua * (now - data->since_us);
+	data->since_us = now;
+}
+
+uint32_t energy_connection_ua(uint32_t interval_us)
+{
+	return interval_us ? (uint64_t)CONFIG_APP_ENERGY_RADIO_UA * CONFIG_APP_ENERGY_CONN_EVENT_US /
+			     interval_us : 0;
+}
+
+void energy_publish(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&energy_lock);
+	uint64_t now = now_us();
+	uint64_t uptime = MAX(now - started_us, 1);
+	uint64_t total = (uint64_t)CONFIG_APP_ENERGY_SLEEP_UA * uptime;
+	uint32_t average;
+	int i;
+
+	for (i = 0; i < __TELEMETRY_ENERGY_MAX; ++i) {
+		// Consumers which stay on for long, like a connection, are brought up to date too
+		account(i, now);
+
+		TELEMETRY_SET(energy_nah[i], (uint32_t)(consumers[i].charge_pc / PC_PER_NAH));
+		total += consumers[i].charge_pc;
+	}
+
+	average = MAX(total / uptime, 1);
+
+	TELEMETRY_SET(energy_total_nah, (uint32_t)(total / PC_PER_NAH));
+	TELEMETRY_SET(energy_average_ua, average);
+	TELEMETRY_SET(energy_life_h, CONFIG_APP_ENERGY_BATTERY_MAH * 1000 / average);
+
+	k_spin_unlock(&energy_lock, key);
+}
+
+void energy_change(unsigned int consumer, uint32_t from_ua, uint32_t to_ua)
+{
+	energy_consumer_t *data;
+	k_spinlock_key_t key;
+
+	if (consumer >= __TELEMETRY_ENERGY_MAX) {
+		return;
+	}
+
+	data = &consumers[consumer];
+	key = k_spin_lock(&energy_lock);
+
+	account(consumer, now_us());
+
+	// An instance switched off twice cannot take the total below zero
+	data->current_ua -= MIN(from_ua, data->current_ua);
+	data->current_ua += to_ua;
+
+	k_spin_unlock(&energy_lock, key);
+}
+
+void energy_on(unsigned int consumer)
+{
+	energy_change(consumer, 0, current_ua(consumer));
+}
+
+void energy_off(unsigned int consumer)
+{
+	energy_change(consumer, current_ua(consumer), 0);
+}
+
+int energy_init(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&energy_lock);
+	int i;
+
+	started_us = now_us();
+
+	for (i = 0; i < __TELEMETRY_ENERGY_MAX; ++i) {
+		consumers[i] = (energy_consumer_t) {
+			.since_us = started_us,
+		};
+	}
+
+	k_spin_unlock(&energy_lock, key);
+
+	return 0;
+}
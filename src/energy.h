@@ -0,0 +1,74 @@
+/**
+ * @file    energy.h
+ * @author  Matthijs Bakker
+ * @date    2026-10-18
+ * @brief   Estimated charge drawn per subsystem
+ *
+ * Consumers are switched on and off around the code which keeps them
+ * busy. The on-time of every consumer is multiplied by its current from
+ * Kconfig and added up with the baseline current into a running charge
+ * estimate and a projected battery life, which are published to the
+ * telemetry when it is read. A consumer with several instances (LEDs,
+ * connections) is switched on once per instance. A connection draws the
+ * current of its own interval, it is switched with ENERGY_CHANGE().
+ *
+ * Without CONFIG_APP_ENERGY, the markers compile to nothing.
+ */
+
+#include <stdint.h>
+
+#include "telemetry.h"
+
+#if CONFIG_APP_ENERGY
+
+#define ENERGY_ON(consumer)         energy_on(TELEMETRY_ENERGY_ ## consumer)
+#define ENERGY_OFF(consumer)        energy_off(TELEMETRY_ENERGY_ ## consumer)
+#define ENERGY_CHANGE(consumer, from_ua, to_ua) \
+	energy_change(TELEMETRY_ENERGY_ ## consumer, from_ua, to_ua)
+
+/**
+ * Start accounting from the current uptime.
+ *
+ * @returns 0 on success,
+ *          >0 on failure
+ */
+int energy_init(void);
+
+/**
+ * Switch on one instance of a consumer, use ENERGY_ON().
+ */
+void energy_on(unsigned int consumer);
+
+/**
+ * Switch off one instance of a consumer, use ENERGY_OFF().
+ */
+void energy_off(unsigned int consumer);
+
+/**
+ * Change the current of one instance of a consumer, use ENERGY_CHANGE().
+ * Switching on is a change from 0 uA, switching off a change to 0 uA.
+ */
+void energy_change(unsigned int consumer, uint32_t from_ua, uint32_t to_ua);
+
+/**
+ * Radio current of a connection with the given interval.
+ */
+uint32_t energy_connection_ua(uint32_t interval_us);
+
+/**
+ * Bring the charge of every consumer up to date and publish the totals
+ * to the telemetry.
+ */
+void energy_publish(void);
+
+#else
+
+#define ENERGY_ON(consumer)         ((void)0)
+#define ENERGY_OFF(consumer)        ((void)0)
+#define ENERGY_CHANGE(consumer, from_ua, to_ua) ((void)(from_ua), (void)(to_ua))
+
+static inline int energy_init(void) { return 0; }
+static inline uint32_t energy_connection_ua(uint32_t interval_us) { return 0; }
+static inline void energy_publish(void) {}
+
+#endif
@@ -0,0 +1,349 @@
+/**
+ * @file    flash_cache.c
+ * @author  Matthijs Bakker
+ * @date    2026-10-18
+ * @brief   Flash disk with a write-back erase page cache
+ *
+ * The host writes 512-byte sectors, but the flash can only be erased in
+ * whole pages. Writing every sector straight through would erase the same
+ * page up to eight times during a single file copy. Instead, written sectors
+ * are merged into a page sized buffer which is programmed once on eviction,
+ * after a short idle period, on USB suspend or when the host syncs the cache.
+ */
+
+#include "flash_cache.h"
+
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/storage/disk_access.h>
+#include <zephyr/storage/flash_map.h>
+#include <zephyr/drivers/disk.h>
+#include <zephyr/drivers/flash.h>
+
+#define SECTOR_SIZE                 512
+#define PAGE_SIZE                   CONFIG_APP_FLASH_DISK_CACHE_PAGE_SIZE
+#define SECTORS_PER_PAGE            (PAGE_SIZE / SECTOR_SIZE)
+
+#define STORAGE_PARTITION_ID        FIXED_PARTITION_ID(storage_partition)
+
+BUILD_ASSERT(PAGE_SIZE % SECTOR_SIZE == 0, "Page size must be a multiple of the sector size");
+
+typedef struct {
+	off_t offset;
+	uint32_t last_used;
+	bool valid;
+	bool dirty;
+	uint8_t data[PAGE_SIZE] __aligned(4);
+} cache_page_t;
+
+static const struct flash_area *storage_area;
+static cache_page_t cache_pages[CONFIG_APP_FLASH_DISK_CACHE_PAGES];
+static uint32_t cache_clock;
+static flash_cache_stats_t cache_stats;
+
+static struct k_work_delayable idle_flush_work;
+
+K_MUTEX_DEFINE(cache_lock);
+
+LOG_MODULE_REGISTER(flash_cache);
+
+static int page_flush(cache_page_t *page)
+{
+	uint32_t start, elapsed;
+	int err;
+
+	if (!page->valid || !page->dirty) {
+		return 0;
+	}
+
+	start = k_cycle_get_32();
+
+	err = flash_area_erase(storage_area, page->offset, PAGE_SIZE);
+
+	if (err) {
+		LOG_ERR("Failed to erase page at 0x%lx, err %d", (long)page->offset, err);
+		return 1;
+	}
+
+	++cache_stats.page_erases;
+
+	err = flash_area_write(storage_area, page->offset, page->data, PAGE_SIZE);
+
+	if (err) {
+		LOG_ERR("Failed to write page at 0x%lx, err %d", (long)page->offset, err);
+		return 2;
+	}
+
+	page->dirty = false;
+
+	elapsed = k_cyc_to_us_floor32(k_cycle_get_32() - start);
+
+	++cache_stats.flushes;
+	cache_stats.flush_time_total_us += elapsed;
+
+	if (elapsed > cache_stats.flush_time_max_us) {
+		cache_stats.flush_time_max_us = elapsed;
+	}
+
+	return 0;
+}
+
+static cache_page_t *page_find(off_t offset)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(cache_pages); ++i) {
+		if (cache_pages[i].valid && cache_pages[i].offset == offset) {
+			return &cache_pages[i];
+		}
+	}
+
+	return NULL;
+}
+
+static cache_page_t *page_claim(off_t offset, bool overwrite)
+{
+	cache_page_t *page = NULL;
+	int i, err;
+
+	// Prefer an empty slot, otherwise evict the least recently used page
+	for (i = 0; i < ARRAY_SIZE(cache_pages); ++i) {
+		if (!cache_pages[i].valid) {
+			page = &cache_pages[i];
+			break;
+		}
+
+		if (!page || cache_pages[i].last_used < page->last_used) {
+			page = &cache_pages[i];
+		}
+	}
+
+	if (page_flush(page)) {
+		return NULL;
+	}
+
+	page->valid = false;
+
+	// A write that covers the whole page does not need the old contents
+	if (!overwrite) {
+		err = flash_area_read(storage_area, offset, page->data, PAGE_SIZE);
+
+		if (err) {
+			LOG_ERR("Failed to load page at 0x%lx, err %d", (long)offset, err);
+			return NULL;
+		}
+
+		++cache_stats.page_loads;
+	}
+
+	page->offset = offset;
+	page->dirty = false;
+	page->valid = true;
+
+	return page;
+}
+
+static void idle_flush_handler(struct k_work *work)
+{
+	ARG_UNUSED(work);
+
+	flash_cache_flush();
+}
+
+static int disk_flash_init(struct disk_info *disk)
+{
+	ARG_UNUSED(disk);
+
+	return 0;
+}
+
+static int disk_flash_status(struct disk_info *disk)
+{
+	ARG_UNUSED(disk);
+
+	return storage_area ? DISK_STATUS_OK : DISK_STATUS_UNINIT;
+}
+
+static int disk_flash_read(struct disk_info *disk, uint8_t *buf, uint32_t sector, uint32_t count)
+{
+	const cache_page_t *page;
+	off_t offset;
+	int err = 0;
+
+	k_mutex_lock(&cache_lock, K_FOREVER);
+
+	for (; count; --count, ++sector, buf += SECTOR_SIZE) {
+		offset = (off_t)sector * SECTOR_SIZE;
+		page = page_find(ROUND_DOWN(offset, PAGE_SIZE));
+
+		if (page) {
+			memcpy(buf, &page->data[offset - page->offset], SECTOR_SIZE);
+		} else {
+			err = flash_area_read(storage_area, offset, buf, SECTOR_SIZE);
+
+			if (err) {
+				LOG_ERR("Failed to read sector %u, err %d", sector, err);
+				err = -EIO;
+				break;
+			}
+		}
+
+		++cache_stats.sectors_read;
+	}
+
+	k_mutex_unlock(&cache_lock);
+
+	return err;
+}
+
+static int disk_flash_write(struct disk_info *disk, const uint8_t *buf, uint32_t sector, uint32_t count)
+{
+	cache_page_t *page;
+	off_t offset, page_offset;
+	bool overwrite;
+	int err = 0;
+
+	k_mutex_lock(&cache_lock, K_FOREVER);
+
+	for (; count; --count, ++sector, buf += SECTOR_SIZE) {
+		offset = (off_t)sector * SECTOR_SIZE;
+		page_offset = ROUND_DOWN(offset, PAGE_SIZE);
+		page = page_find(page_offset);
+
+		if (page) {
+			if (page->dirty) {
+				++cache_stats.sectors_merged;
+			}
+		} else {
+			overwrite = (offset == page_offset && count >= SECTORS_PER_PAGE);
+			page = page_claim(page_offset, overwrite);
+
+			if (!page) {
+				err = -EIO;
+				break;
+			}
+		}
+
+		memcpy(&page->data[offset - page_offset], buf, SECTOR_SIZE);
+
+		page->dirty = true;
+		page->last_used = ++cache_clock;
+
+		++cache_stats.sectors_written;
+	}
+
+	k_mutex_unlock(&cache_lock);
+
+	k_work_reschedule(&idle_flush_work, K_MSEC(CONFIG_APP_FLASH_DISK_CACHE_IDLE_FLUSH_MS));
+
+	return err;
+}
+
+static int disk_flash_ioctl(struct disk_info *disk, uint8_t cmd, void *buf)
+{
+	switch (cmd) {
+		case DISK_IOCTL_CTRL_INIT:
+		case DISK_IOCTL_CTRL_DEINIT:
+			return 0;
+		case DISK_IOCTL_CTRL_SYNC:
+			return flash_cache_flush() ? -EIO : 0;
+		case DISK_IOCTL_GET_SECTOR_COUNT:
+			*(uint32_t *)buf = storage_area->fa_size / SECTOR_SIZE;
+			return 0;
+		case DISK_IOCTL_GET_SECTOR_SIZE:
+			*(uint32_t *)buf = SECTOR_SIZE;
+			return 0;
+		case DISK_IOCTL_GET_ERASE_BLOCK_SZ:
+			*(uint32_t *)buf = SECTORS_PER_PAGE;
+			return 0;
+		default:
+			return -EINVAL;
+	}
+}
+
+static const struct disk_operations disk_flash_ops = {
+	.init = disk_flash_init,
+	.status = disk_flash_status,
+	.read = disk_flash_read,
+	.write = disk_flash_write,
+	.ioctl = disk_flash_ioctl,
+};
+
+static struct disk_info disk_flash = {
+	.name = "NAND",
+	.ops = &disk_flash_ops,
+};
+
+int flash_cache_init(void)
+{
+	struct flash_pages_info info;
+	int err;
+
+	err = flash_area_open(STORAGE_PARTITION_ID, &storage_area);
+
+	if (err) {
+		LOG_ERR("Failed to open storage partition, err %d", err);
+		return 1;
+	}
+
+	err = flash_get_page_info_by_offs(flash_area_get_device(storage_area), storage_area->fa_off, &info);
+
+	if (err) {
+		LOG_ERR("Failed to get storage page size, err %d", err);
+	} else if (info.size != PAGE_SIZE) {
+		LOG_ERR("Storage page size %u does not match cache page size %u", info.size, PAGE_SIZE);
+	}
+
+	if (err || info.size != PAGE_SIZE) {
+		flash_area_close(storage_area);
+		storage_area = NULL;
+		return 2;
+	}
+
+	k_work_init_delayable(&idle_flush_work, idle_flush_handler);
+
+	err = disk_access_register(&disk_flash);
+
+	if (err) {
+		LOG_ERR("Failed to register flash disk, err %d", err);
+		return 3;
+	}
+
+	return 0;
+}
+
+int flash_cache_flush(void)
+{
+	uint32_t erases;
+	int i, err = 0;
+
+	k_mutex_lock(&cache_lock, K_FOREVER);
+
+	erases = cache_stats.page_erases;
+
+	for (i = 0; i < ARRAY_SIZE(cache_pages); ++i) {
+		if (page_flush(&cache_pages[i])) {
+			err = 1;
+		}
+	}
+
+	// The wear per written sector, to compare cache sizes
+	if (erases != cache_stats.page_erases) {
+		LOG_INF("Flushed, %u sectors written, %u merged, %u page erases, flush max %u us",
+			cache_stats.sectors_written, cache_stats.sectors_merged,
+			cache_stats.page_erases, cache_stats.flush_time_max_us);
+	}
+
+	k_mutex_unlock(&cache_lock);
+
+	return err;
+}
+
+void flash_cache_stats_get(flash_cache_stats_t *stats)
+{
+	k_mutex_lock(&cache_lock, K_FOREVER);
+	*stats = cache_stats;
+	k_mutex_unlock(&cache_lock);
+}
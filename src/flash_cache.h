@@ -0,0 +1,50 @@
+/**
+ * @file    flash_cache.h
+ * @author  Matthijs Bakker
+ * @date    2026-10-18
+ * @brief   Flash disk with a write-back erase page cache
+ */
+
+#include <stdint.h>
+
+/**
+ * Wear and latency counters of the flash disk.
+ */
+typedef struct {
+	uint32_t sectors_read;
+	uint32_t sectors_written;
+	uint32_t sectors_merged;
+	uint32_t page_loads;
+	uint32_t page_erases;
+	uint32_t flushes;
+	uint32_t flush_time_total_us;
+	uint32_t flush_time_max_us;
+} flash_cache_stats_t;
+
+/**
+ * Register the "NAND" disk on top of the storage partition.
+ *
+ * Sector writes are collected per erase page in RAM, so that a page
+ * is only erased and programmed once for all sectors written to it.
+ *
+ * @returns 0 on success,
+ *          >0 on failure
+ */
+int flash_cache_init(void);
+
+/**
+ * Write all dirty pages back to flash.
+ *
+ * Called on idle, USB suspend and SCSI SYNCHRONIZE CACHE.
+ *
+ * @returns 0 on success,
+ *          >0 on failure
+ */
+int flash_cache_flush(void);
+
+/**
+ * Copy the current counters.
+ *
+ * @param stats location to store the counters
+ */
+void flash_cache_stats_get(flash_cache_stats_t *stats);
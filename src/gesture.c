@@ -0,0 +1,303 @@
+/**
+ * @file    gesture.c
+ * @author  Matthijs Bakker
+ * @date    2026-10-18
+ * @brief   Table-driven tap, hold and chord recognition
+ *
+ * Every definition is chained into a per-mask list when the engine is
+ * initialized, so a mask change only looks at the handful of definitions
+ * for that exact mask. All deadlines live in one hashed timer wheel of
+ * GESTURE_WHEEL_SLOTS slots; deadlines further out than one revolution
+ * simply stay in their slot until their time has come.
+ */
+
+#include "gesture.h"
+
+#define NO_DEF                      0xff
+
+static bool time_reached(uint32_t deadline, uint32_t now)
+{
+	return (int32_t)(now - deadline) >= 0;
+}
+
+static bool is_hold(gesture_type_t type)
+{
+	return type == GESTURE_LONG_PRESS || type == GESTURE_CHORD_HOLD;
+}
+
+static void timer_cancel(gesture_timer_t *timer)
+{
+	if (!timer->pprev) {
+		return;
+	}
+
+	*timer->pprev = timer->next;
+
+	if (timer->next) {
+		timer->next->pprev = timer->pprev;
+	}
+
+	timer->next = NULL;
+	timer->pprev = NULL;
+}
+
+static void timer_start(gesture_engine_t *engine, gesture_timer_t *timer, uint32_t deadline)
+{
+	gesture_timer_t **slot = &engine->wheel[(deadline / GESTURE_WHEEL_TICK_MS) % GESTURE_WHEEL_SLOTS];
+
+	timer_cancel(timer);
+
+	timer->deadline = deadline;
+	timer->next = *slot;
+	timer->pprev = slot;
+
+	if (*slot) {
+		(*slot)->pprev = &timer->next;
+	}
+
+	*slot = timer;
+}
+
+static void wheel_advance(gesture_engine_t *engine, uint32_t now)
+{
+	uint32_t tick, ticks;
+	gesture_timer_t *timer;
+	uint32_t i;
+
+	if (!engine->wheel_started) {
+		engine->wheel_time = now;
+		engine->wheel_started = true;
+	}
+
+	tick = engine->wheel_time / GESTURE_WHEEL_TICK_MS;
+	ticks = now / GESTURE_WHEEL_TICK_MS - tick;
+
+	// After a gap of a whole revolution or more, which includes a wrap of the
+	// millisecond counter, every slot may hold expired timers: visit each once
+	if (now - engine->wheel_time >= GESTURE_WHEEL_SLOTS * GESTURE_WHEEL_TICK_MS ||
+	    ticks >= GESTURE_WHEEL_SLOTS) {
+		ticks = GESTURE_WHEEL_SLOTS - 1;
+	}
+
+	for (i = 0; i <= ticks; ++i) {
+		gesture_timer_t **slot = &engine->wheel[(tick + i) % GESTURE_WHEEL_SLOTS];
+
+		// Expiry handlers may start timers, so rescan the slot after each one
+		do {
+			for (timer = *slot; timer; timer = timer->next) {
+				if (time_reached(timer->deadline, now)) {
+					break;
+				}
+			}
+
+			if (timer) {
+				timer_cancel(timer);
+				timer->expire(engine);
+			}
+		} while (timer);
+	}
+
+	engine->wheel_time = now;
+}
+
+static const gesture_def_t *find(const gesture_engine_t *engine, uint32_t mask, gesture_type_t type)
+{
+	uint8_t i;
+
+	if (mask >= (1 << GESTURE_MAX_KEYS)) {
+		return NULL;
+	}
+
+	for (i = engine->first_def[mask]; i != NO_DEF; i = engine->next_def[i]) {
+		if (engine->defs[i].type == type) {
+			return &engine->defs[i];
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * Shortest hold definition for mask which takes at least min_ms.
+ */
+static const gesture_def_t *find_hold(const gesture_engine_t *engine, uint32_t mask, uint32_t min_ms)
+{
+	const gesture_def_t *best = NULL;
+	uint8_t i;
+
+	if (mask >= (1 << GESTURE_MAX_KEYS)) {
+		return NULL;
+	}
+
+	for (i = engine->first_def[mask]; i != NO_DEF; i = engine->next_def[i]) {
+		const gesture_def_t *def = &engine->defs[i];
+
+		if (is_hold(def->type) && def->time_ms >= min_ms && (!best || def->time_ms < best->time_ms)) {
+			best = def;
+		}
+	}
+
+	return best;
+}
+
+static void fire(gesture_engine_t *engine, const gesture_def_t *def)
+{
+	if (def) {
+		engine->handler(engine, def);
+	}
+}
+
+static void hold_expire(gesture_engine_t *engine)
+{
+	const gesture_def_t *def = engine->hold_def;
+
+	engine->hold_fired = true;
+
+	fire(engine, def);
+
+	// Longer holds of the same mask continue from the same start
+	engine->hold_def = find_hold(engine, engine->mask, def->time_ms + 1);
+
+	if (engine->hold_def) {
+		timer_start(engine, &engine->hold_timer, engine->hold_start + engine->hold_def->time_ms);
+	}
+}
+
+static void tap_expire(gesture_engine_t *engine)
+{
+	uint32_t mask = engine->pending_tap_mask;
+
+	engine->pending_tap_mask = 0;
+
+	fire(engine, find(engine, mask, GESTURE_TAP));
+}
+
+static void tap_recognized(gesture_engine_t *engine, uint32_t mask, uint32_t now)
+{
+	const gesture_def_t *double_tap = find(engine, mask, GESTURE_DOUBLE_TAP);
+
+	// A tap of another mask ends the wait for a double tap
+	if (engine->pending_tap_mask && engine->pending_tap_mask != mask) {
+		timer_cancel(&engine->tap_timer);
+		tap_expire(engine);
+	}
+
+	if (!double_tap) {
+		fire(engine, find(engine, mask, GESTURE_TAP));
+		return;
+	}
+
+	if (engine->pending_tap_mask == mask) {
+		timer_cancel(&engine->tap_timer);
+		engine->pending_tap_mask = 0;
+		fire(engine, double_tap);
+		return;
+	}
+
+	engine->pending_tap_mask = mask;
+	timer_start(engine, &engine->tap_timer, now + double_tap->time_ms);
+}
+
+int gesture_init(gesture_engine_t *engine, const gesture_def_t *defs, size_t count,
+		 gesture_handler_t handler, void *user_data)
+{
+	size_t i;
+
+	if (count > GESTURE_MAX_DEFS) {
+		return 1;
+	}
+
+	*engine = (gesture_engine_t) {
+		.defs = defs,
+		.def_count = count,
+		.handler = handler,
+		.user_data = user_data,
+		.hold_timer.expire = hold_expire,
+		.tap_timer.expire = tap_expire,
+	};
+
+	for (i = 0; i < (1 << GESTURE_MAX_KEYS); ++i) {
+		engine->first_def[i] = NO_DEF;
+	}
+
+	// Build the chains back to front, so they keep the order of the table
+	for (i = count; i-- > 0;) {
+		if (defs[i].mask == 0 || defs[i].mask >= (1 << GESTURE_MAX_KEYS)) {
+			return 2;
+		}
+
+		engine->next_def[i] = engine->first_def[defs[i].mask];
+		engine->first_def[defs[i].mask] = i;
+	}
+
+	return 0;
+}
+
+void gesture_input(gesture_engine_t *engine, uint32_t mask, uint32_t now)
+{
+	const gesture_def_t *def;
+	uint8_t i;
+
+	wheel_advance(engine, now);
+
+	if (mask == engine->mask) {
+		return;
+	}
+
+	timer_cancel(&engine->hold_timer);
+	engine->hold_def = NULL;
+
+	if (!engine->mask) {
+		engine->episode_mask = mask;
+		engine->episode_start = now;
+		engine->hold_fired = false;
+	} else {
+		engine->episode_mask |= mask;
+	}
+
+	// Keys were added to form a chord
+	if ((mask & (mask - 1)) && (mask & engine->mask) == engine->mask && mask < (1 << GESTURE_MAX_KEYS)) {
+		for (i = engine->first_def[mask]; i != NO_DEF; i = engine->next_def[i]) {
+			if (engine->defs[i].type == GESTURE_CHORD) {
+				fire(engine, &engine->defs[i]);
+			}
+		}
+	}
+
+	engine->mask = mask;
+
+	if (mask) {
+		def = find_hold(engine, mask, 0);
+
+		if (def) {
+			engine->hold_def = def;
+			engine->hold_start = now;
+			timer_start(engine, &engine->hold_timer, now + def->time_ms);
+		}
+
+		return;
+	}
+
+	if (!engine->hold_fired && now - engine->episode_start <= GESTURE_TAP_MAX_MS) {
+		tap_recognized(engine, engine->episode_mask, now);
+	}
+}
+
+uint32_t gesture_tick(gesture_engine_t *engine, uint32_t now)
+{
+	uint32_t next = GESTURE_NO_DEADLINE;
+	gesture_timer_t *timer;
+	size_t i;
+
+	wheel_advance(engine, now);
+
+	for (i = 0; i < GESTURE_WHEEL_SLOTS; ++i) {
+		for (timer = engine->wheel[i]; timer; timer = timer->next) {
+			if (next == GESTURE_NO_DEADLINE || (int32_t)(timer->deadline - next) < 0) {
+				next = timer->deadline;
+			}
+		}
+	}
+
+	return next;
+}
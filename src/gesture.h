@@ -0,0 +1,110 @@
+/**
+ * @file    gesture.h
+ * @author  Matthijs Bakker
+ * @date    2026-10-18
+ * @brief   Table-driven tap, hold and chord recognition
+ *
+ * The engine is plain C without any Zephyr dependencies, so that it can be
+ * fed synthetic event streams on the host. Gestures are described by a
+ * constant table, the engine only sees key masks and millisecond timestamps.
+ *
+ * Recognition never holds back the key reports themselves: the caller
+ * reports every mask change as usual and the engine calls the handler on
+ * the side once a gesture has been recognized.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define GESTURE_MAX_KEYS            8
+#define GESTURE_MAX_DEFS            32
+#define GESTURE_TAP_MAX_MS          300     // longest press that still counts as a tap
+#define GESTURE_WHEEL_SLOTS         16
+#define GESTURE_WHEEL_TICK_MS       32
+#define GESTURE_NO_DEADLINE         UINT32_MAX
+
+typedef enum {
+	GESTURE_TAP,                // mask pressed and released within GESTURE_TAP_MAX_MS
+	GESTURE_DOUBLE_TAP,         // two taps of mask within time_ms
+	GESTURE_LONG_PRESS,         // single key held for time_ms
+	GESTURE_CHORD,              // multiple keys pressed together
+	GESTURE_CHORD_HOLD,         // multiple keys held together for time_ms
+} gesture_type_t;
+
+typedef struct {
+	gesture_type_t type;
+	uint32_t mask;
+	uint32_t time_ms;
+	int action;
+} gesture_def_t;
+
+typedef struct gesture_engine gesture_engine_t;
+
+/**
+ * Called when a gesture has been recognized.
+ */
+typedef void (*gesture_handler_t)(gesture_engine_t *engine, const gesture_def_t *gesture);
+
+typedef struct gesture_timer {
+	struct gesture_timer *next;
+	struct gesture_timer **pprev;
+	uint32_t deadline;
+	void (*expire)(gesture_engine_t *engine);
+} gesture_timer_t;
+
+struct gesture_engine {
+	const gesture_def_t *defs;
+	size_t def_count;
+	gesture_handler_t handler;
+	void *user_data;
+
+	// Definitions per exact mask, chained through next_def
+	uint8_t first_def[1 << GESTURE_MAX_KEYS];
+	uint8_t next_def[GESTURE_MAX_DEFS];
+
+	gesture_timer_t *wheel[GESTURE_WHEEL_SLOTS];
+	uint32_t wheel_time;
+	bool wheel_started;         // wheel_time is seeded by the first input or tick
+
+	gesture_timer_t hold_timer;
+	gesture_timer_t tap_timer;
+
+	uint32_t mask;
+	uint32_t episode_mask;      // union of all keys since the first press
+	uint32_t episode_start;
+	uint32_t hold_start;
+	const gesture_def_t *hold_def;
+	bool hold_fired;
+
+	uint32_t pending_tap_mask;
+};
+
+/**
+ * Prepare an engine for the given gesture table.
+ *
+ * @param engine     engine to initialize
+ * @param defs       gesture table, must stay valid
+ * @param count      number of entries in the table
+ * @param handler    called for every recognized gesture
+ * @param user_data  stored in the engine for the handler
+ *
+ * @returns 0 on success,
+ *          >0 if the table is too large or uses too many keys
+ */
+int gesture_init(gesture_engine_t *engine, const gesture_def_t *defs, size_t count,
+		 gesture_handler_t handler, void *user_data);
+
+/**
+ * Feed the current mask of pressed keys.
+ *
+ * Expired deadlines up to now are handled first.
+ */
+void gesture_input(gesture_engine_t *engine, uint32_t mask, uint32_t now);
+
+/**
+ * Handle all deadlines up to now.
+ *
+ * @returns the time of the next deadline, or GESTURE_NO_DEADLINE
+ */
+uint32_t gesture_tick(gesture_engine_t *engine, uint32_t now);
@@ -0,0 +1,275 @@
+/**
+ * @file    health.c
+ * @author  Matthijs Bakker
+ * @date    2026-10-18
+ * @brief   Thread, stack, queue and interrupt statistics
+ *
+ * Sampling runs on the system work queue, away from the scan. A pass
+ * walks all threads once and scans their stacks for the high-water mark,
+ * its own cost is reported as health_sample_us.
+ */
+
+#include "health.h"
+#include "telemetry.h"
+
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
+
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/gatt.h>
+#include <zephyr/bluetooth/uuid.h>
+
+#if CONFIG_SHELL
+#include <zephyr/shell/shell.h>
+#endif
+
+#define BT_UUID_HEALTH_SERVICE_VAL \
+	BT_UUID_128_ENCODE(0x6d626368, 0x6561, 0x6c74, 0x6800, 0x000000000001)
+#define BT_UUID_HEALTH_CHRC_VAL \
+	BT_UUID_128_ENCODE(0x6d626368, 0x6561, 0x6c74, 0x6800, 0x000000000002)
+
+#define HEALTH_BIN_MAGIC            0x4d424348 // "MBCH"
+#define HEALTH_BIN_VERSION          1
+#define HEALTH_TEXT_SIZE            3072
+
+// The characteristic carries the health part of telemetry_t, thread_count up to health_sample_us
+#define HEALTH_FIRST                offsetof(telemetry_t, thread_count)
+#define HEALTH_LENGTH               (offsetof(telemetry_t, health_sample_us) + sizeof(uint32_t) - HEALTH_FIRST)
+#define HEALTH_BIN_SIZE             (sizeof(health_bin_header_t) + HEALTH_LENGTH)
+
+typedef struct __packed {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t length;
+	uint32_t uptime_ms;
+} health_bin_header_t;
+
+BUILD_ASSERT(HEALTH_BIN_SIZE <= BT_ATT_MAX_ATTRIBUTE_LEN, "Health data does not fit an attribute");
+
+typedef struct {
+	const struct k_thread *thread;
+	uint64_t cycles;
+	bool seen;
+} health_thread_prev_t;
+
+static health_thread_prev_t prev_threads[TELEMETRY_MAX_THREADS];
+static uint64_t prev_total_cycles;
+
+// Filled by a sampling pass, then copied into the telemetry under telemetry_table_lock
+static telemetry_thread_t threads[TELEMETRY_MAX_THREADS];
+static uint32_t thread_count;
+
+static struct k_msgq *queues[TELEMETRY_MAX_QUEUES];
+
+static void sample_process(struct k_work *work);
+
+static K_WORK_DELAYABLE_DEFINE(sample_work, sample_process);
+
+LOG_MODULE_REGISTER(health);
+
+/**
+ * Execution cycles of a thread at the previous pass. A thread seen for the
+ * first time has no baseline yet and gets its current count, so that its
+ * lifetime is not reported as the usage of one interval.
+ */
+static uint64_t prev_cycles(const struct k_thread *thread, uint64_t cycles)
+{
+	uint64_t prev;
+	int i;
+
+	for (i = 0; i < TELEMETRY_MAX_THREADS; ++i) {
+		if (prev_threads[i].thread == thread) {
+			prev = prev_threads[i].cycles;
+			prev_threads[i].cycles = cycles;
+			prev_threads[i].seen = true;
+			return prev;
+		}
+	}
+
+	for (i = 0; i < TELEMETRY_MAX_THREADS; ++i) {
+		if (!prev_threads[i].thread) {
+			prev_threads[i] = (health_thread_prev_t) {
+				.thread = thread,
+				.cycles = cycles,
+				.seen = true,
+			};
+			break;
+		}
+	}
+
+	return cycles;
+}
+
+// Forget threads which did not show up in the last pass, their slot may be reused
+static void prev_threads_sweep(void)
+{
+	int i;
+
+	for (i = 0; i < TELEMETRY_MAX_THREADS; ++i) {
+		if (!prev_threads[i].seen) {
+			prev_threads[i].thread = NULL;
+		}
+
+		prev_threads[i].seen = false;
+	}
+}
+
+static void sample_thread(const struct k_thread *thread, void *user_data)
+{
+	struct k_thread *mutable = (struct k_thread *)thread;
+	uint64_t *total = user_data;
+	k_thread_runtime_stats_t stats;
+	telemetry_thread_t *data;
+	const char *name;
+	size_t unused = 0;
+	uint64_t cycles;
+
+	if (thread_count >= TELEMETRY_MAX_THREADS) {
+		return;
+	}
+
+	data = &threads[thread_count++];
+
+	name = k_thread_name_get(mutable);
+	strncpy(data->name, name ? name : "?", sizeof(data->name) - 1);
+
+	if (!k_thread_runtime_stats_get(mutable, &stats)) {
+		cycles = stats.execution_cycles - prev_cycles(thread, stats.execution_cycles);
+		data->cpu_permille = *total ? (uint16_t)(cycles * 1000 / *total) : 0;
+	}
+
+	data->stack_size = thread->stack_info.size;
+
+	if (!k_thread_stack_space_get(thread, &unused)) {
+		data->stack_used = thread->stack_info.size - unused;
+	}
+}
+
+static void sample_process(struct k_work *work)
+{
+	uint32_t start = k_cycle_get_32();
+	k_thread_runtime_stats_t all;
+	uint64_t total = 0;
+	int i;
+
+	ARG_UNUSED(work);
+
+	if (!k_thread_runtime_stats_all_get(&all)) {
+		total = all.execution_cycles - prev_total_cycles;
+		prev_total_cycles = all.execution_cycles;
+	}
+
+	memset(threads, 0, sizeof(threads));
+	thread_count = 0;
+
+	k_thread_foreach_unlocked(sample_thread, &total);
+
+	prev_threads_sweep();
+
+	k_mutex_lock(&telemetry_table_lock, K_FOREVER);
+
+	memcpy(telemetry.threads, threads, sizeof(threads));
+	telemetry.thread_count = thread_count;
+
+	for (i = 0; i < TELEMETRY_MAX_QUEUES && queues[i]; ++i) {
+		telemetry_queue_t *data = &telemetry.queues[i];
+
+		data->used = k_msgq_num_used_get(queues[i]);
+		data->used_max = MAX(data->used_max, data->used);
+		data->size = queues[i]->max_msgs;
+	}
+
+	k_mutex_unlock(&telemetry_table_lock);
+
+	TELEMETRY_SET(health_sample_us, k_cyc_to_us_floor32(k_cycle_get_32() - start));
+
+	k_work_schedule(&sample_work, K_MSEC(CONFIG_APP_HEALTH_INTERVAL_MS));
+}
+
+void health_watch_msgq(const char *name, struct k_msgq *msgq)
+{
+	int i;
+
+	k_mutex_lock(&telemetry_table_lock, K_FOREVER);
+
+	for (i = 0; i < TELEMETRY_MAX_QUEUES; ++i) {
+		if (!queues[i]) {
+			strncpy(telemetry.queues[i].name, name, TELEMETRY_NAME_LEN - 1);
+			telemetry.queue_count = i + 1;
+			queues[i] = msgq;
+			k_mutex_unlock(&telemetry_table_lock);
+			return;
+		}
+	}
+
+	k_mutex_unlock(&telemetry_table_lock);
+
+	LOG_WRN("No room to watch queue %s", name);
+}
+
+static ssize_t health_read(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+			   void *buf, uint16_t len, uint16_t offset)
+{
+	static uint8_t snapshot[HEALTH_BIN_SIZE];
+	health_bin_header_t header = {
+		.magic = sys_cpu_to_le32(HEALTH_BIN_MAGIC),
+		.version = sys_cpu_to_le16(HEALTH_BIN_VERSION),
+		.length = sys_cpu_to_le16(HEALTH_LENGTH),
+		.uptime_ms = sys_cpu_to_le32(k_uptime_get_32()),
+	};
+
+	// Long reads continue from the snapshot taken by the first part
+	if (!offset) {
+		memcpy(snapshot, &header, sizeof(header));
+
+		k_mutex_lock(&telemetry_table_lock, K_FOREVER);
+		memcpy(&snapshot[sizeof(header)], (const uint8_t *)&telemetry + HEALTH_FIRST, HEALTH_LENGTH);
+		k_mutex_unlock(&telemetry_table_lock);
+	}
+
+	return bt_gatt_attr_read(conn, attr, buf, len, offset, snapshot, sizeof(snapshot));
+}
+
+BT_GATT_SERVICE_DEFINE(health_svc,
+	BT_GATT_PRIMARY_SERVICE(BT_UUID_DECLARE_128(BT_UUID_HEALTH_SERVICE_VAL)),
+	BT_GATT_CHARACTERISTIC(BT_UUID_DECLARE_128(BT_UUID_HEALTH_CHRC_VAL),
+			       BT_GATT_CHRC_READ,
+			       BT_GATT_PERM_READ_AUTHEN,
+			       health_read, NULL, NULL),
+);
+
+#if CONFIG_SHELL
+static int cmd_stats(const struct shell *sh, size_t argc, char **argv)
+{
+	static char text[HEALTH_TEXT_SIZE];
+	size_t len;
+
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	len = telemetry_format_text(text, sizeof(text) - 1);
+	text[len] = '\0';
+
+	shell_print(sh, "%s", text);
+
+	return 0;
+}
+
+SHELL_CMD_REGISTER(stats, NULL, "Print the runtime counters", cmd_stats);
+#endif
+
+int health_init(void)
+{
+#if CONFIG_APP_HEALTH_ISR_TIMING
+	// Only enabled, the counter may already be in use elsewhere and all timings are deltas
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+
+	k_work_schedule(&sample_work, K_MSEC(CONFIG_APP_HEALTH_INTERVAL_MS));
+
+	return 0;
+}
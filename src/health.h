@@ -0,0 +1,66 @@
+/**
+ * @file    health.h
+ * @author  Matthijs Bakker
+ * @date    2026-10-18
+ * @brief   Thread, stack, queue and interrupt statistics
+ *
+ * Once per CONFIG_APP_HEALTH_INTERVAL_MS, the CPU usage and stack high-water
+ * mark of every thread and the occupancy of the watched message queues are
+ * sampled into the telemetry. The counters are read through STATS.TXT,
+ * STATS.BIN, the health GATT characteristic and the "stats" shell command.
+ *
+ * Without CONFIG_APP_HEALTH, all of this compiles to nothing.
+ */
+
+#include <zephyr/kernel.h>
+
+#include "telemetry.h"
+
+#if CONFIG_APP_HEALTH_ISR_TIMING
+#include <cmsis_core.h>
+
+// Must be the first statement of the interrupt handler
+#define HEALTH_ISR_ENTER()          uint32_t health_isr_start = DWT->CYCCNT
+
+// Before every return of the handler which should be timed
+#define HEALTH_ISR_EXIT(field) \
+	do { \
+		telemetry_isr_time_t *time = &telemetry.isr_ ## field ## _time; \
+		uint32_t cycles = DWT->CYCCNT - health_isr_start; \
+		time->last = cycles; \
+		time->min = (time->min && time->min < cycles) ? time->min : cycles; \
+		time->max = MAX(time->max, cycles); \
+	} while (0)
+#else
+#define HEALTH_ISR_ENTER()          ((void)0)
+#define HEALTH_ISR_EXIT(field)      ((void)0)
+#endif
+
+#if CONFIG_APP_HEALTH
+
+#define HEALTH_ISR_COUNT(field)     TELEMETRY_INC(isr_ ## field)
+
+/**
+ * Start sampling.
+ *
+ * @returns 0 on success,
+ *          >0 on failure
+ */
+int health_init(void);
+
+/**
+ * Sample the occupancy of a message queue.
+ *
+ * @param name  short name in the telemetry
+ * @param msgq  queue to sample
+ */
+void health_watch_msgq(const char *name, struct k_msgq *msgq);
+
+#else
+
+#define HEALTH_ISR_COUNT(field)     ((void)0)
+
+static inline int health_init(void) { return 0; }
+static inline void health_watch_msgq(const char *name, struct k_msgq *msgq) {}
+
+#endif
@@ -0,0 +1,213 @@
+/**
+ * @file    keymap.c
+ * @author  Matthijs Bakker
+ * @date    2026-10-18
+ * @brief   Remappable HID usages per mode
+ */
+
+#include "keymap.h"
+
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/settings/settings.h>
+#include <zephyr/sys/byteorder.h>
+
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/gatt.h>
+#include <zephyr/bluetooth/uuid.h>
+
+#define KEYMAP_SETTINGS_ROOT        "keymap"
+
+#define BT_UUID_KEYMAP_SERVICE_VAL \
+	BT_UUID_128_ENCODE(0x6d62636b, 0x6579, 0x6d61, 0x7000, 0x000000000001)
+#define BT_UUID_KEYMAP_CHRC_VAL \
+	BT_UUID_128_ENCODE(0x6d62636b, 0x6579, 0x6d61, 0x7000, 0x000000000002)
+
+/**
+ * Assignment written to the keymap characteristic.
+ */
+typedef struct __packed {
+	uint8_t mode;
+	uint8_t slot;
+	uint16_t usage;
+} keymap_write_t;
+
+static const char *const mode_names[] = {
+	[KEYMAP_MODE_MEDIA]      = "media",
+	[KEYMAP_MODE_NAVIGATION] = "nav",
+};
+
+static const uint16_t default_usages[__KEYMAP_MODE_MAX][__KEYMAP_SLOT_MAX] = KEYMAP_DEFAULTS;
+
+BUILD_ASSERT(__KEYMAP_CONSUMER_MAX == 8, "The consumer report is a single byte");
+BUILD_ASSERT(ARRAY_SIZE(mode_names) == __KEYMAP_MODE_MAX);
+BUILD_ASSERT(__KEYMAP_SLOT_MAX <= 32, "Reports take the slots as a 32-bit mask");
+
+static uint16_t usages[__KEYMAP_MODE_MAX][__KEYMAP_SLOT_MAX];
+static atomic_t dirty_modes;
+
+static void save_process(struct k_work *work);
+
+static K_WORK_DEFINE(save_work, save_process);
+
+uint8_t keymap[__KEYMAP_MODE_MAX][__KEYMAP_SLOT_MAX];
+
+LOG_MODULE_REGISTER(keymap);
+
+static int slot_assign(keymap_mode_t mode, keymap_slot_t slot, uint16_t usage)
+{
+	uint8_t value;
+
+	if (mode >= __KEYMAP_MODE_MAX || slot >= __KEYMAP_SLOT_MAX) {
+		return 1;
+	}
+
+	if (keymap_usage_value(mode, usage, &value)) {
+		return 2;
+	}
+
+	usages[mode][slot] = usage;
+	keymap[mode][slot] = value;
+
+	return 0;
+}
+
+static void save_process(struct k_work *work)
+{
+	atomic_val_t modes = atomic_clear(&dirty_modes);
+	char key[32];
+	int mode;
+	int err;
+
+	ARG_UNUSED(work);
+
+	for (mode = 0; mode < __KEYMAP_MODE_MAX; ++mode) {
+		if (!(modes & BIT(mode))) {
+			continue;
+		}
+
+		snprintk(key, sizeof(key), KEYMAP_SETTINGS_ROOT "/%s", mode_names[mode]);
+
+		err = settings_save_one(key, usages[mode], sizeof(usages[mode]));
+
+		if (err) {
+			LOG_ERR("Failed to store keymap %s, err %d", mode_names[mode], err);
+		}
+	}
+}
+
+int keymap_assign(keymap_mode_t mode, keymap_slot_t slot, uint16_t usage)
+{
+	int err;
+
+	err = slot_assign(mode, slot, usage);
+
+	if (err) {
+		return err;
+	}
+
+	LOG_INF("Mode %s slot %d is now usage 0x%02x", mode_names[mode], slot, usage);
+
+	// Flash writes do not belong in the caller's context
+	if (IS_ENABLED(CONFIG_SETTINGS)) {
+		atomic_or(&dirty_modes, BIT(mode));
+		k_work_submit(&save_work);
+	}
+
+	return 0;
+}
+
+static int keymap_settings_set(const char *name, size_t len, settings_read_cb read_cb, void *cb_arg)
+{
+	uint16_t stored[__KEYMAP_SLOT_MAX];
+	const char *next;
+	ssize_t read;
+	int mode, slot;
+
+	for (mode = 0; mode < __KEYMAP_MODE_MAX; ++mode) {
+		if (settings_name_steq(name, mode_names[mode], &next) && !next) {
+			break;
+		}
+	}
+
+	if (mode == __KEYMAP_MODE_MAX) {
+		return -ENOENT;
+	}
+
+	read = read_cb(cb_arg, stored, MIN(len, sizeof(stored)));
+
+	if (read < 0) {
+		return read;
+	}
+
+	// Slots added by newer firmware keep their defaults
+	for (slot = 0; slot < read / sizeof(stored[0]); ++slot) {
+		if (slot_assign(mode, slot, stored[slot])) {
+			LOG_WRN("Ignoring stored usage 0x%02x for %s slot %d", stored[slot], mode_names[mode], slot);
+		}
+	}
+
+	return 0;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(keymap, KEYMAP_SETTINGS_ROOT, NULL, keymap_settings_set, NULL, NULL);
+
+static ssize_t keymap_read(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+			   void *buf, uint16_t len, uint16_t offset)
+{
+	uint16_t value[__KEYMAP_MODE_MAX][__KEYMAP_SLOT_MAX];
+	int mode, slot;
+
+	for (mode = 0; mode < __KEYMAP_MODE_MAX; ++mode) {
+		for (slot = 0; slot < __KEYMAP_SLOT_MAX; ++slot) {
+			value[mode][slot] = sys_cpu_to_le16(usages[mode][slot]);
+		}
+	}
+
+	return bt_gatt_attr_read(conn, attr, buf, len, offset, value, sizeof(value));
+}
+
+static ssize_t keymap_write(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+			    const void *buf, uint16_t len, uint16_t offset, uint8_t flags)
+{
+	keymap_write_t request;
+
+	if (offset) {
+		return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
+	}
+
+	if (len != sizeof(request)) {
+		return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+	}
+
+	memcpy(&request, buf, sizeof(request));
+
+	if (keymap_assign(request.mode, request.slot, sys_le16_to_cpu(request.usage))) {
+		return BT_GATT_ERR(BT_ATT_ERR_VALUE_NOT_ALLOWED);
+	}
+
+	return len;
+}
+
+BT_GATT_SERVICE_DEFINE(keymap_svc,
+	BT_GATT_PRIMARY_SERVICE(BT_UUID_DECLARE_128(BT_UUID_KEYMAP_SERVICE_VAL)),
+	BT_GATT_CHARACTERISTIC(BT_UUID_DECLARE_128(BT_UUID_KEYMAP_CHRC_VAL),
+			       BT_GATT_CHRC_READ | BT_GATT_CHRC_WRITE,
+			       BT_GATT_PERM_READ_AUTHEN | BT_GATT_PERM_WRITE_AUTHEN,
+			       keymap_read, keymap_write, NULL),
+);
+
+int keymap_init(void)
+{
+	int mode, slot;
+
+	for (mode = 0; mode < __KEYMAP_MODE_MAX; ++mode) {
+		for (slot = 0; slot < __KEYMAP_SLOT_MAX; ++slot) {
+			slot_assign(mode, slot, default_usages[mode][slot]);
+		}
+	}
+
+	return 0;
+}
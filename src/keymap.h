@@ -0,0 +1,220 @@
+/**
+ * @file    keymap.h
+ * @author  Matthijs Bakker
+ * @date    2026-10-18
+ * @brief   Remappable HID usages per mode
+ *
+ * Every mode has a flat array with one entry per slot. The entries hold
+ * report-ready values, so building a report costs one indexed load per
+ * pressed key: a bit of the consumer report in media mode, a keyboard
+ * keycode in navigation mode.
+ *
+ * The usages are stored in settings under "keymap/<mode>" and can be
+ * changed through the keymap GATT service.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <zephyr/kernel.h>
+
+/**
+ * Consumer usages which can be assigned in media mode.
+ *
+ * The consumer input report has one bit per entry, in this order, and its
+ * report map is generated from this list.
+ */
+#define KEYMAP_CONSUMER_USAGES(X) \
+	X(MUTE,             0xE2) \
+	X(PLAY_PAUSE,       0xCD) \
+	X(VOLUME_UP,        0xE9) \
+	X(VOLUME_DOWN,      0xEA) \
+	X(NEXT_TRACK,       0xB5) \
+	X(PREVIOUS_TRACK,   0xB6) \
+	X(STOP,             0xB7) \
+	X(FAST_FORWARD,     0xB3)
+
+#define KEYMAP_KEYBOARD_USAGE_MAX   0x65    // must match the logical maximum of the keyboard report
+#define KEYMAP_USAGE_NONE           0x00    // unassigned, reports nothing in either mode
+
+#define KEYMAP_CONSUMER_INDEX(name, id)     KEYMAP_CONSUMER_##name,
+#define KEYMAP_CONSUMER_CASE(name, id)      case id: return BIT(KEYMAP_CONSUMER_##name);
+
+/**
+ * Bit of each consumer usage in the consumer input report.
+ */
+typedef enum {
+	KEYMAP_CONSUMER_USAGES(KEYMAP_CONSUMER_INDEX)
+
+	__KEYMAP_CONSUMER_MAX,
+} keymap_consumer_t;
+
+typedef enum {
+	KEYMAP_MODE_MEDIA,
+	KEYMAP_MODE_NAVIGATION,
+
+	__KEYMAP_MODE_MAX,
+} keymap_mode_t;
+
+/**
+ * Slots 0 to 3 are the keys, at the bit position of their ble_hid_key_t.
+ *
+ * The gesture slots are sent as a press and release once their gesture is
+ * recognized, on top of the reports of the keys themselves. They are
+ * unassigned by default. The mode switch (holding key 0 for 3 s) and the
+ * pairing confirmation (holding keys 2 and 3) are not slots, so that no
+ * keymap can make them unreachable.
+ */
+typedef enum {
+	KEYMAP_SLOT_KEY0,
+	KEYMAP_SLOT_KEY1,
+	KEYMAP_SLOT_KEY2,
+	KEYMAP_SLOT_KEY3,
+	KEYMAP_SLOT_SLIDE_UP,
+	KEYMAP_SLOT_SLIDE_DOWN,
+	KEYMAP_SLOT_DOUBLE_TAP_KEY0,
+	KEYMAP_SLOT_DOUBLE_TAP_KEY1,
+	KEYMAP_SLOT_DOUBLE_TAP_KEY2,
+	KEYMAP_SLOT_DOUBLE_TAP_KEY3,
+	KEYMAP_SLOT_LONG_PRESS_KEY0,
+	KEYMAP_SLOT_LONG_PRESS_KEY1,
+	KEYMAP_SLOT_LONG_PRESS_KEY2,
+	KEYMAP_SLOT_LONG_PRESS_KEY3,
+	KEYMAP_SLOT_CHORD_KEY2_KEY3,
+
+	__KEYMAP_SLOT_MAX,
+} keymap_slot_t;
+
+/**
+ * Initializer of the default usages, a uint16_t [__KEYMAP_MODE_MAX][__KEYMAP_SLOT_MAX].
+ * The gesture slots are left unassigned.
+ */
+#define KEYMAP_DEFAULTS \
+	{ \
+		[KEYMAP_MODE_MEDIA] = { \
+			[KEYMAP_SLOT_KEY0]       = 0xE2, /* mute */ \
+			[KEYMAP_SLOT_KEY1]       = 0xCD, /* play/pause */ \
+			[KEYMAP_SLOT_KEY2]       = 0xE9, /* volume up */ \
+			[KEYMAP_SLOT_KEY3]       = 0xEA, /* volume down */ \
+			[KEYMAP_SLOT_SLIDE_UP]   = 0xE9, \
+			[KEYMAP_SLOT_SLIDE_DOWN] = 0xEA, \
+		}, \
+		[KEYMAP_MODE_NAVIGATION] = { \
+			[KEYMAP_SLOT_KEY0]       = 0x4F, /* right */ \
+			[KEYMAP_SLOT_KEY1]       = 0x50, /* left */ \
+			[KEYMAP_SLOT_KEY2]       = 0x52, /* up */ \
+			[KEYMAP_SLOT_KEY3]       = 0x51, /* down */ \
+			[KEYMAP_SLOT_SLIDE_UP]   = 0x52, \
+			[KEYMAP_SLOT_SLIDE_DOWN] = 0x51, \
+		}, \
+	}
+
+extern uint8_t keymap[__KEYMAP_MODE_MAX][__KEYMAP_SLOT_MAX];
+
+/**
+ * Load the default keymap.
+ *
+ * Must be called before the settings are loaded, stored assignments
+ * are applied on top of the defaults.
+ *
+ * @returns 0 on success,
+ *          >0 on failure
+ */
+int keymap_init(void);
+
+/**
+ * Consumer report bit of a usage.
+ *
+ * @returns the bit, or 0 if the usage is not in KEYMAP_CONSUMER_USAGES
+ */
+static inline uint8_t keymap_consumer_bit(uint16_t usage)
+{
+	switch (usage) {
+	KEYMAP_CONSUMER_USAGES(KEYMAP_CONSUMER_CASE)
+	default:
+		return 0;
+	}
+}
+
+/**
+ * Convert a usage to its report value, see the file description.
+ *
+ * @returns 0 on success,
+ *          >0 if the usage cannot be reported in this mode
+ */
+static inline int keymap_usage_value(keymap_mode_t mode, uint16_t usage, uint8_t *value)
+{
+	if (usage == KEYMAP_USAGE_NONE) {
+		*value = 0;
+		return 0;
+	}
+
+	switch (mode) {
+	case KEYMAP_MODE_MEDIA:
+		*value = keymap_consumer_bit(usage);
+		return !*value;
+	case KEYMAP_MODE_NAVIGATION:
+		if (usage > KEYMAP_KEYBOARD_USAGE_MAX) {
+			return 1;
+		}
+		*value = usage;
+		return 0;
+	default:
+		return 1;
+	}
+}
+
+/**
+ * Report value of a slot, see the file description.
+ */
+static inline uint8_t keymap_get(keymap_mode_t mode, keymap_slot_t slot)
+{
+	return keymap[mode][slot];
+}
+
+/**
+ * Fill the key array of a keyboard report with the navigation mode
+ * usages of the slots. Slots beyond the size of the array are left out.
+ *
+ * @param slots  one bit per keymap slot
+ * @param keys   key array of the report, zeroed by the caller
+ * @param count  number of keys in the report
+ */
+static inline void keymap_navigation_keys(uint32_t slots, uint8_t *keys, size_t count)
+{
+	size_t len = 0;
+
+	while (slots && len < count) {
+		keys[len++] = keymap_get(KEYMAP_MODE_NAVIGATION, find_lsb_set(slots) - 1);
+		slots &= slots - 1;
+	}
+}
+
+/**
+ * Consumer report of the media mode usages of the slots.
+ *
+ * @param slots  one bit per keymap slot
+ */
+static inline uint8_t keymap_media_bits(uint32_t slots)
+{
+	uint8_t bits = 0;
+
+	while (slots) {
+		bits |= keymap_get(KEYMAP_MODE_MEDIA, find_lsb_set(slots) - 1);
+		slots &= slots - 1;
+	}
+
+	return bits;
+}
+
+/**
+ * Assign a HID usage to a slot and store the keymap of the mode.
+ *
+ * @param mode   mode to change
+ * @param slot   slot to change
+ * @param usage  consumer usage in media mode, keyboard usage in navigation mode
+ *
+ * @returns 0 on success,
+ *          >0 if the slot is unknown or the usage cannot be reported in this mode
+ */
+int keymap_assign(keymap_mode_t mode, keymap_slot_t slot, uint16_t usage);
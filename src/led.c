@@ -3,94 +3,469 @@
  * @author  Matthijs Bakker
  * @date    2026-02-07
  * @brief   LEDs control
+ *
+ * Patterns are rendered by one of two backends.
+ *
+ * The GPIO backend drives all LEDs from a single one-shot timer. Each LED
+ * keeps the deadline of its next edge, and the timer is always armed for the
+ * earliest of those deadlines. Edges are applied from the timer callback,
+ * so blinking does not need a thread or any context switches.
+ *
+ * The PWM backend (CONFIG_APP_LED_PWM) gives every LED its own PWM instance.
+ * A pattern is compiled into two sequences in RAM, one for the on phase
+ * (including fades) and one for the off phase, which EasyDMA plays back
+ * repeatedly without waking up the CPU. Only the end of a finite pattern
+ * raises an interrupt.
  */
 
 #include "led.h"
+#include "bus.h"
+#include "energy.h"
+#include "telemetry.h"
 
 #include <zephyr/logging/log.h>
 
-#define LED_DEFINE(name, _index) \
-    K_MSGQ_DEFINE(name ## _led_msgq, sizeof(k_timeout_t), 10, 1); \
-    static const led_data_t name ## _led_data = { \
+#if CONFIG_APP_LED_PWM
+#include <nrfx_pwm.h>
+
+#define LED_PWM_TOP                 250     // 125 kHz / 250 = 500 Hz
+#define LED_PWM_PERIOD_US           2000
+#define LED_PWM_POLARITY_HIGH       BIT(15) // output is high for the duty cycle
+#define LED_PWM_MAX_STEPS           64
+
+#define LED_DEFINE(name, _index, _pwm) \
+    [_index] = { \
+        .gpio_spec = GPIO_DT_SPEC_GET(DT_ALIAS(name ## _led), gpios), \
+        .pwm = NRFX_PWM_INSTANCE(_pwm), \
+        .pwm_pin = NRF_DT_GPIOS_TO_PSEL(DT_ALIAS(name ## _led), gpios), \
+        .active_low = DT_GPIO_FLAGS(DT_ALIAS(name ## _led), gpios) & GPIO_ACTIVE_LOW, \
+    }
+#else
+#define LED_DEFINE(name, _index, _pwm) \
+    [_index] = { \
         .gpio_spec = GPIO_DT_SPEC_GET(DT_ALIAS(name ## _led), gpios), \
-        .index = _index, \
-        .msgq = & name ## _led_msgq, \
-    }; \
-    K_THREAD_DEFINE(name ## _led_thread_id, 4096, led_thread, &name ## _led_data, NULL, NULL, 12, 0, 1);
+    }
+#endif
+
+typedef struct {
+	const struct gpio_dt_spec gpio_spec;
+	led_pattern_t pattern;
+	led_priority_t priority;
+	uint16_t remaining;
+	bool active;
+	bool on;
+	bool metered;               // counted as lit by the energy accounting
+	int64_t deadline;
+
+#if CONFIG_APP_LED_PWM
+	const nrfx_pwm_t pwm;
+	const uint32_t pwm_pin;
+	const bool active_low;
+	uint16_t seq_on[LED_PWM_MAX_STEPS];
+	uint16_t seq_off[1];
+#endif
+} led_data_t;
+
+const led_pattern_t led_pattern_short   = { .on_ms = 100,  .repeat = 1, .brightness = LED_BRIGHTNESS_FULL };
+const led_pattern_t led_pattern_normal  = { .on_ms = 500,  .repeat = 1, .brightness = LED_BRIGHTNESS_FULL };
+const led_pattern_t led_pattern_long    = { .on_ms = 2000, .repeat = 1, .brightness = LED_BRIGHTNESS_FULL };
+const led_pattern_t led_pattern_pending = { .on_ms = 100,  .off_ms = 100, .repeat = LED_REPEAT_FOREVER,
+                                            .brightness = LED_BRIGHTNESS_FULL };
+const led_pattern_t led_pattern_breathe = { .on_ms = 2000, .off_ms = 500, .fade_ms = 1000,
+                                            .repeat = LED_REPEAT_FOREVER, .brightness = LED_BRIGHTNESS_FULL };
 
-static const led_data_t *led_data[__LED_INDEX_MAX];
+static led_data_t led_data[__LED_INDEX_MAX] = {
+	LED_DEFINE(red,   LED_INDEX_RED,   0),
+	LED_DEFINE(green, LED_INDEX_GREEN, 1),
+	LED_DEFINE(blue,  LED_INDEX_BLUE,  2),
+};
+
+static struct k_spinlock led_lock;
+static bool led_ready;
 
 LOG_MODULE_REGISTER(led);
 
-static void led_thread(void *data_p)
+static void led_meter(led_data_t *data, bool lit)
 {
-    const led_data_t *data = data_p;
-    k_timeout_t timeout, blink_rate = K_FOREVER;
-    int err;
+	if (lit == data->metered) {
+		return;
+	}
 
-    led_data[data->index] = data;
+	data->metered = lit;
 
-    if (!gpio_is_ready_dt(&data->gpio_spec)) {
-        LOG_ERR("LED %d thread: gpio not ready", data->index);
-        k_sleep(K_FOREVER);
-    }
+	if (lit) {
+		ENERGY_ON(LED);
+	} else {
+		ENERGY_OFF(LED);
+	}
+}
 
-    err = gpio_pin_configure_dt(&data->gpio_spec, GPIO_OUTPUT_INACTIVE);
+#if CONFIG_APP_LED_PWM
 
-    if (err < 0) {
-        LOG_ERR("Failed to configure led %d gpio, err %d", data->index, err);
-        k_sleep(K_FOREVER);
-    }
+static void pwm_handler(nrfx_pwm_evt_type_t event, void *context)
+{
+	led_data_t *data = context;
+	k_spinlock_key_t key;
 
-    while (true) {
-        err = k_msgq_get(data->msgq, &timeout, blink_rate);
-
-        if (err && err != -EAGAIN) {
-            LOG_ERR("Failed to get from msgq, err %d", err);
-            continue;
-        }
-
-        if (err != -EAGAIN) {
-            switch (timeout.ticks) {
-                case 0:
-                    blink_rate = K_FOREVER;
-                    continue;
-                case SYS_FOREVER_MS:
-                    blink_rate = timeout = LED_SHORT_BLINK_DURATION;
-                    break;
-                default:
-                    blink_rate = K_FOREVER;
-                    break;
-            }
-        }
-
-        gpio_pin_set_dt(&data->gpio_spec, 1);
-
-        k_sleep(timeout);
-        
-        gpio_pin_set_dt(&data->gpio_spec, 0);
-    }
+	if (event != NRFX_PWM_EVT_STOPPED) {
+		return;
+	}
+
+	key = k_spin_lock(&led_lock);
+
+	// A pattern started since the sequence ended is left running
+	if (nrfx_pwm_stopped_check(&data->pwm)) {
+		data->active = false;
+		led_meter(data, false);
+	}
+
+	k_spin_unlock(&led_lock, key);
+}
+
+static uint32_t pwm_periods(uint32_t ms)
+{
+	return MAX(ms * 1000 / LED_PWM_PERIOD_US, 1);
+}
+
+static int output_init(led_data_t *data)
+{
+	nrfx_pwm_config_t config = NRFX_PWM_DEFAULT_CONFIG(
+		data->pwm_pin | (data->active_low ? NRFX_PWM_PIN_INVERTED : 0),
+		NRF_PWM_PIN_NOT_CONNECTED, NRF_PWM_PIN_NOT_CONNECTED, NRF_PWM_PIN_NOT_CONNECTED);
+	nrfx_err_t err;
+
+	config.base_clock = NRF_PWM_CLK_125kHz;
+	config.top_value = LED_PWM_TOP;
+	config.load_mode = NRF_PWM_LOAD_COMMON;
+
+	err = nrfx_pwm_init(&data->pwm, &config, pwm_handler, data);
+
+	return (err == NRFX_SUCCESS) ? 0 : -EIO;
+}
+
+static void output_start(led_data_t *data)
+{
+	const led_pattern_t *pattern = &data->pattern;
+	uint16_t polarity = data->active_low ? 0 : LED_PWM_POLARITY_HIGH;
+	uint16_t peak = (uint16_t)pattern->brightness * LED_PWM_TOP / LED_BRIGHTNESS_FULL;
+	uint32_t on_periods = pwm_periods(pattern->on_ms);
+	uint32_t steps = 1, step_periods = on_periods, ramp = 0;
+	uint32_t i, flags;
+	nrf_pwm_sequence_t seq_on, seq_off;
+
+	// Fades need multiple steps, spread the on phase evenly over them
+	if (pattern->fade_ms) {
+		steps = MIN(on_periods, LED_PWM_MAX_STEPS);
+		step_periods = on_periods / steps;
+		ramp = MIN(pwm_periods(pattern->fade_ms) / step_periods, steps / 2);
+	}
+
+	for (i = 0; i < steps; ++i) {
+		uint32_t level = peak;
+
+		if (i < ramp) {
+			level = peak * (i + 1) / ramp;
+		} else if (i >= steps - ramp) {
+			level = peak * (steps - i) / ramp;
+		}
+
+		data->seq_on[i] = polarity | level;
+	}
+
+	data->seq_off[0] = polarity;
+
+	seq_on = (nrf_pwm_sequence_t) {
+		.values.p_common = data->seq_on,
+		.length = steps,
+		.repeats = step_periods - 1,
+	};
+
+	seq_off = (nrf_pwm_sequence_t) {
+		.values.p_common = data->seq_off,
+		.length = 1,
+		.repeats = pwm_periods(pattern->off_ms) - 1,
+	};
+
+	flags = (pattern->repeat == LED_REPEAT_FOREVER) ? NRFX_PWM_FLAG_LOOP : NRFX_PWM_FLAG_STOP;
+
+	// The whole pattern counts as on time, fades and off phases are not taken into account
+	led_meter(data, pattern->brightness);
+
+	if (pattern->off_ms) {
+		nrfx_pwm_complex_playback(&data->pwm, &seq_on, &seq_off, MAX(pattern->repeat, 1), flags);
+	} else {
+		nrfx_pwm_simple_playback(&data->pwm, &seq_on, MAX(pattern->repeat, 1), flags);
+	}
+}
+
+static void output_stop(led_data_t *data)
+{
+	nrfx_pwm_stop(&data->pwm, false);
+	led_meter(data, false);
+}
+
+#else
+
+static struct k_timer led_timer;
+
+static void led_set(led_data_t *data, bool on)
+{
+	data->on = on;
+	gpio_pin_set_dt(&data->gpio_spec, on && data->pattern.brightness);
+	led_meter(data, on && data->pattern.brightness);
+}
+
+// Must be called with led_lock held
+static void timer_rearm(void)
+{
+	int64_t next = INT64_MAX;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(led_data); ++i) {
+		if (led_data[i].active && led_data[i].deadline < next) {
+			next = led_data[i].deadline;
+		}
+	}
+
+	if (next == INT64_MAX) {
+		k_timer_stop(&led_timer);
+	} else {
+		k_timer_start(&led_timer, K_TIMEOUT_ABS_TICKS(next), K_NO_WAIT);
+	}
+}
+
+static void led_step(led_data_t *data)
+{
+	if (data->on) {
+		led_set(data, false);
+
+		if (data->pattern.repeat != LED_REPEAT_FOREVER && --data->remaining == 0) {
+			data->active = false;
+			return;
+		}
+
+		data->deadline += k_ms_to_ticks_ceil64(data->pattern.off_ms);
+	} else {
+		led_set(data, true);
+
+		data->deadline += k_ms_to_ticks_ceil64(data->pattern.on_ms);
+	}
+}
+
+static void led_timer_handler(struct k_timer *timer)
+{
+	k_spinlock_key_t key = k_spin_lock(&led_lock);
+	int64_t now = k_uptime_ticks();
+	int i;
+
+	ARG_UNUSED(timer);
+
+	for (i = 0; i < ARRAY_SIZE(led_data); ++i) {
+		while (led_data[i].active && led_data[i].deadline <= now) {
+			led_step(&led_data[i]);
+			TELEMETRY_INC(led_edges);
+		}
+	}
+
+	timer_rearm();
+
+	k_spin_unlock(&led_lock, key);
+}
+
+static int output_init(led_data_t *data)
+{
+	if (!gpio_is_ready_dt(&data->gpio_spec)) {
+		return -ENODEV;
+	}
+
+	return gpio_pin_configure_dt(&data->gpio_spec, GPIO_OUTPUT_INACTIVE);
+}
+
+static void output_start(led_data_t *data)
+{
+	data->remaining = data->pattern.repeat;
+	data->deadline = k_uptime_ticks() + k_ms_to_ticks_ceil64(data->pattern.on_ms);
+
+	led_set(data, true);
+	timer_rearm();
+}
+
+static void output_stop(led_data_t *data)
+{
+	led_set(data, false);
+	timer_rearm();
+}
+
+#endif
+
+int led_init(void)
+{
+	int i, err;
+
+#if CONFIG_APP_LED_PWM
+	IRQ_CONNECT(PWM0_IRQn, 5, nrfx_isr, nrfx_pwm_0_irq_handler, 0);
+	IRQ_CONNECT(PWM1_IRQn, 5, nrfx_isr, nrfx_pwm_1_irq_handler, 0);
+	IRQ_CONNECT(PWM2_IRQn, 5, nrfx_isr, nrfx_pwm_2_irq_handler, 0);
+#else
+	k_timer_init(&led_timer, led_timer_handler, NULL);
+#endif
+
+	for (i = 0; i < ARRAY_SIZE(led_data); ++i) {
+		err = output_init(&led_data[i]);
+
+		if (err < 0) {
+			LOG_ERR("Failed to configure led %d, err %d", i, err);
+			return 1;
+		}
+	}
+
+	led_ready = true;
+
+	return 0;
+}
+
+int led_play(led_index_t index, const led_pattern_t *pattern, led_priority_t priority)
+{
+	led_data_t *data;
+	k_spinlock_key_t key;
+
+	if (!led_ready || index >= ARRAY_SIZE(led_data)) {
+		LOG_ERR("No LED found with index %d", index);
+		return 1;
+	}
+
+	if (pattern->repeat == LED_REPEAT_FOREVER && !(pattern->on_ms && pattern->off_ms)) {
+		LOG_ERR("Endless pattern needs an on and off time");
+		return 3;
+	}
+
+	data = &led_data[index];
+	key = k_spin_lock(&led_lock);
+
+	if (data->active && data->priority > priority) {
+		k_spin_unlock(&led_lock, key);
+		return 2;
+	}
+
+	data->pattern = *pattern;
+	data->priority = priority;
+	data->active = true;
+
+	output_start(data);
+
+	k_spin_unlock(&led_lock, key);
+
+	return 0;
+}
+
+int led_play_color(const led_color_t *color, const led_pattern_t *pattern, led_priority_t priority)
+{
+	const uint8_t channels[__LED_INDEX_MAX] = {
+		[LED_INDEX_RED]   = color->red,
+		[LED_INDEX_GREEN] = color->green,
+		[LED_INDEX_BLUE]  = color->blue,
+	};
+	led_pattern_t channel_pattern = *pattern;
+	int i, err = 0;
+
+	for (i = 0; i < __LED_INDEX_MAX; ++i) {
+		if (channels[i]) {
+			channel_pattern.brightness = channels[i];
+			err |= led_play(i, &channel_pattern, priority);
+		} else {
+			err |= led_stop(i, priority);
+		}
+	}
+
+	return err ? 1 : 0;
+}
+
+int led_stop(led_index_t index, led_priority_t priority)
+{
+	led_data_t *data;
+	k_spinlock_key_t key;
+
+	if (!led_ready || index >= ARRAY_SIZE(led_data)) {
+		LOG_ERR("No LED found with index %d", index);
+		return 1;
+	}
+
+	data = &led_data[index];
+	key = k_spin_lock(&led_lock);
+
+	if (data->active && data->priority > priority) {
+		k_spin_unlock(&led_lock, key);
+		return 2;
+	}
+
+	data->active = false;
+
+	output_stop(data);
+
+	k_spin_unlock(&led_lock, key);
+
+	return 0;
 }
 
 int led_blink(led_index_t index, k_timeout_t timeout)
 {
-    const led_data_t *data;
-    int i;
+	led_pattern_t pattern = { .repeat = 1, .brightness = LED_BRIGHTNESS_FULL };
 
-    for (i = 0; i < ARRAY_SIZE(led_data); ++i) {
-        data = led_data[i];
+	if (K_TIMEOUT_EQ(timeout, K_NO_WAIT)) {
+		return led_stop(index, LED_PRIORITY_STATUS);
+	}
 
-        if (data->index == index) {
-            k_msgq_put(data->msgq, &timeout, K_NO_WAIT);
-            return 0;
-        }
-    }
+	if (K_TIMEOUT_EQ(timeout, K_FOREVER)) {
+		return led_play(index, &led_pattern_pending, LED_PRIORITY_STATUS);
+	}
 
-    LOG_ERR("No LED found with index %d", index);
+	pattern.on_ms = k_ticks_to_ms_ceil32(timeout.ticks);
 
-    return 1;
+	return led_play(index, &pattern, LED_PRIORITY_STATUS);
 }
 
-LED_DEFINE(red,   LED_INDEX_RED);
-LED_DEFINE(green, LED_INDEX_GREEN);
-LED_DEFINE(blue,  LED_INDEX_BLUE);
+static void ui_listener(const struct zbus_channel *chan)
+{
+	const bus_ui_msg_t *ui = zbus_chan_const_msg(chan);
+	int i;
+
+	switch (ui->event) {
+	case BUS_UI_READY:
+		led_play(LED_INDEX_GREEN, &led_pattern_normal, LED_PRIORITY_STATUS);
+		break;
+	case BUS_UI_PAIRING_PENDING:
+		led_play(LED_INDEX_GREEN, &led_pattern_pending, LED_PRIORITY_ALERT);
+		break;
+	case BUS_UI_PAIRING_DONE:
+		led_play(LED_INDEX_GREEN, &led_pattern_long, LED_PRIORITY_ALERT);
+		break;
+	case BUS_UI_PAIRING_FAILED:
+		led_stop(LED_INDEX_GREEN, LED_PRIORITY_ALERT);
+		led_play(LED_INDEX_RED, &led_pattern_long, LED_PRIORITY_ALERT);
+		break;
+	case BUS_UI_MODE_SWITCH:
+		led_blink(LED_INDEX_GREEN, LED_SHORT_BLINK_DURATION);
+		break;
+	case BUS_UI_SLEEP:
+		for (i = 0; i < __LED_INDEX_MAX; ++i) {
+			led_stop(i, LED_PRIORITY_ALERT);
+		}
+		break;
+	}
+}
+
+static void touch_listener(const struct zbus_channel *chan)
+{
+	const bus_touch_msg_t *touch = zbus_chan_const_msg(chan);
+
+	if (touch->pressed) {
+		led_play(LED_INDEX_BLUE, &led_pattern_short, LED_PRIORITY_FEEDBACK);
+	}
+}
+
+ZBUS_LISTENER_DEFINE(led_ui_lis, ui_listener);
+ZBUS_CHAN_ADD_OBS(bus_ui_chan, led_ui_lis, 0);
+
+// Feedback is shown after the report has been handed to the radio
+ZBUS_LISTENER_DEFINE(led_touch_lis, touch_listener);
+ZBUS_CHAN_ADD_OBS(bus_touch_chan, led_touch_lis, 2);
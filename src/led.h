@@ -12,6 +12,9 @@
 #define LED_NORMAL_BLINK_DURATION   K_MSEC(500)
 #define LED_LONG_BLINK_DURATION     K_MSEC(2000)
 
+#define LED_REPEAT_FOREVER          0
+#define LED_BRIGHTNESS_FULL         255
+
 typedef enum {
 	LED_INDEX_RED,
 	LED_INDEX_GREEN,
@@ -20,10 +23,91 @@ typedef enum {
     __LED_INDEX_MAX,
 } led_index_t;
 
+/**
+ * A pattern only replaces the running pattern of an LED if its
+ * priority is equal or higher.
+ */
+typedef enum {
+	LED_PRIORITY_FEEDBACK,
+	LED_PRIORITY_STATUS,
+	LED_PRIORITY_ALERT,
+
+	__LED_PRIORITY_MAX,
+} led_priority_t;
+
+/**
+ * Blink pattern: on for on_ms, then off for off_ms, repeat times.
+ * A repeat count of LED_REPEAT_FOREVER blinks until the LED is stopped.
+ *
+ * Brightness and fading are only rendered by the PWM backend, the GPIO
+ * backend turns the LED fully on for any non-zero brightness.
+ */
+typedef struct {
+	uint16_t on_ms;
+	uint16_t off_ms;
+	uint16_t fade_ms;
+	uint16_t repeat;
+	uint8_t brightness;
+} led_pattern_t;
+
+/**
+ * Colour of the RGB LED, one brightness per channel.
+ */
 typedef struct {
-	const struct gpio_dt_spec gpio_spec;
-    struct k_msgq *msgq;
-	led_index_t index;
-} led_data_t;
+	uint8_t red;
+	uint8_t green;
+	uint8_t blue;
+} led_color_t;
+
+extern const led_pattern_t led_pattern_short;
+extern const led_pattern_t led_pattern_normal;
+extern const led_pattern_t led_pattern_long;
+extern const led_pattern_t led_pattern_pending;
+extern const led_pattern_t led_pattern_breathe;
 
+/**
+ * Configure the LED GPIOs and the pattern timer.
+ *
+ * @returns 0 on success,
+ *          >0 on failure
+ */
+int led_init(void);
+
+/**
+ * Start a pattern on an LED.
+ *
+ * @param index     LED to play the pattern on
+ * @param pattern   pattern to play, copied by the engine
+ * @param priority  priority of the pattern
+ *
+ * @returns 0 on success,
+ *          >0 if the LED is unknown or busy with a higher priority pattern
+ */
+int led_play(led_index_t index, const led_pattern_t *pattern, led_priority_t priority);
+
+/**
+ * Play a pattern on all channels of the RGB LED, mixed to the given colour.
+ *
+ * Channels with a brightness of zero are stopped. The pattern's own
+ * brightness is ignored.
+ *
+ * @returns 0 on success,
+ *          >0 if any of the channels could not be started
+ */
+int led_play_color(const led_color_t *color, const led_pattern_t *pattern, led_priority_t priority);
+
+/**
+ * Stop the pattern of an LED, if its priority is not higher than the given one.
+ *
+ * @returns 0 on success,
+ *          >0 if the LED is unknown or busy with a higher priority pattern
+ */
+int led_stop(led_index_t index, led_priority_t priority);
+
+/**
+ * Blink an LED once for the given duration.
+ *
+ * K_FOREVER keeps blinking at the short blink rate, K_NO_WAIT stops blinking.
+ * Patterns started through this function use LED_PRIORITY_STATUS.
+ */
 int led_blink(led_index_t index, k_timeout_t timeout);
@@ -8,192 +8,377 @@
 #include <zephyr/kernel.h>
 #include <zephyr/drivers/gpio.h>
 #include <zephyr/logging/log.h>
+#include <nrfx.h>
 
+#include "app_trace.h"
+#include "app_workq.h"
 #include "ble.h"
+#include "bus.h"
+#include "cache_prof.h"
+#include "clock_gov.h"
+#include "detect.h"
+#include "energy.h"
+#include "health.h"
+#include "keymap.h"
 #include "led.h"
+#include "power.h"
+#include "recorder.h"
 #include "sense.h"
+#include "stream.h"
+#include "telemetry.h"
+#include "usb_link.h"
 #include "usbms.h"
 
-#define CALIBRATION_RUNS            8
-#define CALIBRATION_THRESHOLD       1.7
-#define DEBOUNCING_THRESHOLD        4
 #define MAX_SAMPLE_RETRIES          5
+#define SCAN_INTERVAL_MS            9
+
+#define TOUCHPADS_NODE              DT_COMPAT_GET_ANY_STATUS_OKAY(mb_capsense_pads)
+
+// The rest of the scan, sense.c and detect.c, is relocated as a whole by CMakeLists.txt
+#if CONFIG_APP_RAMFUNC
+#define SCAN_RAMFUNC                __ramfunc
+#else
+#define SCAN_RAMFUNC
+#endif
+
+BUILD_ASSERT(DT_HAS_COMPAT_STATUS_OKAY(mb_capsense_pads), "No capsense-pads node in the devicetree");
 
 typedef struct {
 	int analog_input;
 	ble_hid_key_t emulated_key;
-
-    uint32_t threshold;
-    uint8_t debouncing_streak;
-    bool pressed;
+	uint8_t oversampling;
+	uint32_t timeout_ms;        // as taken by sense_pin(), any value of the devicetree fits
 } touchpad_data_t;
 
-static touchpad_data_t touchpad_data[] = {
-#if CONFIG_BOARD_MBC10
-	{
-		.analog_input = COMP_PSEL_PSEL_AnalogInput0,
-		.emulated_key = BLE_HID_KEY_PLAYPAUSE,
-	},
-	{
-		.analog_input = COMP_PSEL_PSEL_AnalogInput3,
-		.emulated_key = BLE_HID_KEY_VOLUME_DOWN,
+#define TOUCHPAD_DATA_INIT(node) \
+	{ \
+		.analog_input = DT_PROP(node, analog_input), \
+		.emulated_key = BIT(DT_PROP(node, key)), \
+		.oversampling = DT_PROP(node, oversampling), \
+		.timeout_ms = DT_PROP(node, timeout_ms), \
 	},
-	{
-		.analog_input = COMP_PSEL_PSEL_AnalogInput1,
-		.emulated_key = BLE_HID_KEY_VOLUME_UP,
-	},
-	{
-		.analog_input = COMP_PSEL_PSEL_AnalogInput5,
-		.emulated_key = BLE_HID_KEY_MUTE,
-	},
-#else
-	{
-		.analog_input = COMP_PSEL_PSEL_AnalogInput3,
-		.emulated_key = BLE_HID_KEY_VOLUME_UP,
-	},
-	{
-		.analog_input = COMP_PSEL_PSEL_AnalogInput0,
-		.emulated_key = BLE_HID_KEY_VOLUME_DOWN,
-	},
-	{
-		.analog_input = COMP_PSEL_PSEL_AnalogInput1,
-		.emulated_key = BLE_HID_KEY_PLAYPAUSE,
-	},
-#endif
+
+#define TOUCHPAD_CHECK(node) \
+	BUILD_ASSERT(DT_PROP(node, key) <= KEYMAP_SLOT_KEY3, "Touchpad key is not a key slot"); \
+	BUILD_ASSERT(DT_PROP(node, oversampling) >= 1 && DT_PROP(node, oversampling) <= UINT8_MAX, \
+		     "Touchpad oversampling must be 1..255"); \
+	BUILD_ASSERT(DT_PROP(node, timeout_ms) >= 1, "Touchpad timeout must be at least 1 ms");
+
+static touchpad_data_t touchpad_data[] = {
+	DT_FOREACH_CHILD_STATUS_OKAY(TOUCHPADS_NODE, TOUCHPAD_DATA_INIT)
 };
 
-static void sampling_thread(void);
+DT_FOREACH_CHILD_STATUS_OKAY(TOUCHPADS_NODE, TOUCHPAD_CHECK)
+
+BUILD_ASSERT(ARRAY_SIZE(touchpad_data) <= TELEMETRY_MAX_PADS, "Too many touchpads for telemetry");
+BUILD_ASSERT(ARRAY_SIZE(touchpad_data) <= DETECT_MAX_PADS, "Too many touchpads for detection");
 
-K_THREAD_DEFINE(sampling_thread_id, 4096, sampling_thread, NULL, NULL, NULL, 10, 0, -1);
+#if CONFIG_APP_SLEEP
+BUILD_ASSERT(CONFIG_APP_SLEEP_WAKE_PAD < ARRAY_SIZE(touchpad_data), "Wake-up pad does not exist");
+#endif
+
+static struct k_work_delayable scan_work;
+static uint32_t scan_interval_ms = SCAN_INTERVAL_MS;
+static detect_t detector;
+
+#if CONFIG_APP_SLEEP
+static atomic_t waking;
+#endif
 
 LOG_MODULE_REGISTER(main);
 
-static void touchpad_state_changed(int index, const touchpad_data_t *data)
+static void touchpad_state_changed(int index, const touchpad_data_t *data, bool pressed)
 {
-	static ble_key_input_t input = {0};
+	static uint32_t pressed_mask = 0;
+	bus_touch_msg_t msg;
 
-	input.button = data->emulated_key;
-	input.button_pressed = data->pressed;
+	APP_TRACE_EVENT("debounce", index, pressed);
+	recorder_event(index, pressed);
 
-	if (data->pressed) {
-		input.pressed_mask |= data->emulated_key;
+	if (pressed) {
+		pressed_mask |= data->emulated_key;
 	} else {
-		input.pressed_mask &= ~(data->emulated_key);
+		pressed_mask &= ~(data->emulated_key);
 	}
 
-	LOG_INF("State change %d %02x", input.button, input.pressed_mask);
+	APP_TRACE("State change %d %02x", data->emulated_key, pressed_mask);
+
+	msg = (bus_touch_msg_t) {
+		.pad = index,
+		.pressed = pressed,
+		.key = data->emulated_key,
+		.pressed_mask = pressed_mask,
+		.timestamp_ms = k_uptime_get_32(),
+		.timestamp_cyc = k_cycle_get_32(),
+	};
+
+	bus_publish(&bus_touch_chan, &msg);
+}
+
+static SCAN_RAMFUNC int touchpad_sample(const touchpad_data_t *pad, uint32_t *value)
+{
+	uint32_t sample, sum = 0;
+	int i;
+	int err;
+
+	for (i = 0; i < pad->oversampling; ++i) {
+		err = sense_pin(pad->analog_input, pad->timeout_ms, &sample);
 
-	ble_send_key_input(&input);
+		if (err) {
+			return err;
+		}
 
-	if (data->pressed) {
-		led_blink(LED_INDEX_BLUE, LED_SHORT_BLINK_DURATION);
+		sum += sample;
 	}
+
+	*value = sum / pad->oversampling;
+
+	return 0;
 }
 
-static void sampling_thread(void)
+#if CONFIG_APP_SLEEP
+static void wake_handler(void)
+{
+	atomic_set(&waking, 1);
+	k_work_reschedule_for_queue(&app_workq, &scan_work, K_NO_WAIT);
+}
+#endif
+
+static SCAN_RAMFUNC void scan_process(struct k_work *work)
 {
 	uint32_t delta_time;
-	bool touch_detected;
-	int calibration_rounds_remaining = CALIBRATION_RUNS;
+	detect_event_t event;
 	int i;
 	int retry = 0;
 	int err;
 
-	LOG_INF("Start sampling thread");
+	ARG_UNUSED(work);
 
-	while (true) {
-		NRF_POWER->TASKS_CONSTLAT = 0;
+#if CONFIG_APP_SLEEP
+	if (atomic_cas(&waking, 1, 0)) {
+		sense_wake_disarm();
+		power_wakeup();
+	}
 
-		k_sleep(K_MSEC(9));
-		
-		NRF_POWER->TASKS_CONSTLAT = 1;
+	if (power_sleep_requested()) {
+		// Calibration is kept, scanning continues where it left off
+		sense_wake_arm(touchpad_data[CONFIG_APP_SLEEP_WAKE_PAD].analog_input, wake_handler);
+		return;
+	}
+#endif
 
-		for (i = 0; i < ARRAY_SIZE(touchpad_data); ++i) {
-			err = sense_pin(touchpad_data[i].analog_input, &delta_time);
+	APP_TRACE_EVENT("scan_start", 0, 0);
+	CACHE_PROF_BEGIN(SCAN);
 
-			if (delta_time < 20 || delta_time > 2000) {
-				err = 69;
-			}
+	NRF_POWER->TASKS_CONSTLAT = 1;
+	ENERGY_ON(SCAN);
 
-			if (err) {
-				if (retry++ < MAX_SAMPLE_RETRIES) {
-					i -= 1;
-					continue;
-				}
+	for (i = 0; i < ARRAY_SIZE(touchpad_data); ++i) {
+		err = touchpad_sample(&touchpad_data[i], &delta_time);
 
-				LOG_ERR("Failed to sample analog pin, err %d", err);
-			}
+		if (!detect_valid(delta_time)) {
+			err = 69;
+		}
 
-			retry = 0;
-
-			if (calibration_rounds_remaining) {
-				touchpad_data[i].threshold += delta_time;
-			} else {
-				touch_detected = (delta_time > touchpad_data[i].threshold);
-
-				if (touchpad_data[i].pressed != touch_detected) {
-					LOG_DBG("Debounce %d %s %d", i, touch_detected ? "up" : "down", touchpad_data[i].debouncing_streak);
-					
-					if (++touchpad_data[i].debouncing_streak > DEBOUNCING_THRESHOLD) {
-						touchpad_data[i].debouncing_streak = 0;
-						touchpad_data[i].pressed = touch_detected;
-						touchpad_state_changed(i, &touchpad_data[i]);
-					}
-				} else {
-					touchpad_data[i].debouncing_streak = 0;
-				}
+		if (err) {
+			TELEMETRY_INC(pads[i].timeouts);
+
+			if (retry++ < MAX_SAMPLE_RETRIES) {
+				i -= 1;
+				continue;
 			}
+
+			LOG_ERR("Failed to sample analog pin, err %d", err);
 		}
 
-		if (calibration_rounds_remaining > 0) {
-			--calibration_rounds_remaining;
-
-			// We just finished the last calibration round.
-			// Calculate the arithmetic mean of the measured values.
-			if (!calibration_rounds_remaining) {
-				
-				for (i = 0; i < ARRAY_SIZE(touchpad_data); ++i) {
-					uint32_t prev = touchpad_data[i].threshold;
-					touchpad_data[i].threshold /= CALIBRATION_RUNS;
-					touchpad_data[i].threshold *= CALIBRATION_THRESHOLD;
-					LOG_INF("Threshold of touchpad %d prev=%d set at %d", i, prev, touchpad_data[i].threshold);
-
-					if (touchpad_data[i].threshold < 0 || touchpad_data[i].threshold > 2000) {
-						touchpad_data[i].threshold = 250;
-					}
-				}
+		retry = 0;
+
+		// The wait for the oscillator above runs at 64 MHz, the detection and reports at 128 MHz
+		clock_gov_boost();
+
+		recorder_sample(i, delta_time, err);
+
+		CACHE_PROF_BEGIN(DETECT);
+		event = detect_sample(&detector, i, delta_time);
+		CACHE_PROF_END(DETECT);
+
+		if (!detector.calibration_remaining) {
+			bus_pad_raw_msg_t raw = {
+				.pad = i,
+				.pad_count = ARRAY_SIZE(touchpad_data),
+				.value = delta_time,
+				.threshold = detector.pads[i].threshold,
+			};
+
+			bus_publish(&bus_pad_raw_chan, &raw);
+
+			if (event != DETECT_EVENT_NONE) {
+				touchpad_state_changed(i, &touchpad_data[i], event == DETECT_EVENT_PRESS);
 			}
 		}
+
+		clock_gov_release();
 	}
+
+	clock_gov_boost();
+
+	TELEMETRY_INC(scans);
+
+	if (detect_scan_end(&detector)) {
+		uint32_t baselines[ARRAY_SIZE(touchpad_data)];
+
+		for (i = 0; i < ARRAY_SIZE(touchpad_data); ++i) {
+			baselines[i] = detector.pads[i].baseline;
+			TELEMETRY_SET(pads[i].baseline, baselines[i]);
+			LOG_INF("Threshold of touchpad %d baseline=%d set at %d", i, baselines[i], detector.pads[i].threshold);
+		}
+
+		recorder_calibrated(baselines, ARRAY_SIZE(touchpad_data));
+
+		TELEMETRY_BOOT_PHASE(TELEMETRY_BOOT_CALIBRATED);
+	}
+
+	clock_gov_release();
+
+	ENERGY_OFF(SCAN);
+	NRF_POWER->TASKS_CONSTLAT = 0;
+
+	CACHE_PROF_END(SCAN);
+	APP_TRACE_EVENT("scan_end", 0, 0);
+
+	k_work_schedule_for_queue(&app_workq, &scan_work, K_MSEC(scan_interval_ms));
 }
 
+static void tune_listener(const struct zbus_channel *chan)
+{
+	const bus_tune_msg_t *tune = zbus_chan_const_msg(chan);
+	detect_config_t config = detector.config;
+
+	switch (tune->param) {
+		case BUS_TUNE_THRESHOLD:
+			config.threshold_ratio = tune->value / 100.0;
+			detect_configure(&detector, &config);
+			break;
+		case BUS_TUNE_DEBOUNCE:
+			config.debounce = tune->value;
+			detect_configure(&detector, &config);
+			break;
+		case BUS_TUNE_OVERSAMPLING:
+			if (tune->pad < ARRAY_SIZE(touchpad_data) && tune->value) {
+				touchpad_data[tune->pad].oversampling = tune->value;
+			}
+			break;
+		case BUS_TUNE_SCAN_PERIOD:
+			scan_interval_ms = tune->value;
+			break;
+		default:
+			return;
+	}
+
+	LOG_INF("Tuned parameter %d of pad %d to %u", tune->param, tune->pad, tune->value);
+}
+
+ZBUS_LISTENER_DEFINE(main_tune_lis, tune_listener);
+ZBUS_CHAN_ADD_OBS(bus_tune_chan, main_tune_lis, 0);
+
 int main(void)
 {
 	int err;
 
 	LOG_INF("Start main");
 
+	app_workq_init();
+
+	err = energy_init();
+
+	if (err) {
+		LOG_ERR("Failed to init energy accounting, err %d", err);
+	}
+
+	err = led_init();
+
+	if (err) {
+		LOG_ERR("Failed to init LEDs, err %d", err);
+	}
+
 	err = usbms_init();
 
 	if (err) {
 		LOG_ERR("Failed to init USB MS, err %d", err);
 	}
 
+	err = usb_link_init();
+
+	if (err) {
+		LOG_ERR("Failed to init USB link, err %d", err);
+	}
+
+	TELEMETRY_BOOT_PHASE(TELEMETRY_BOOT_USBMS);
+
+	err = health_init();
+
+	if (err) {
+		LOG_ERR("Failed to init health sampling, err %d", err);
+	}
+
+	err = cache_prof_init();
+
+	if (err) {
+		LOG_ERR("Failed to init cache profiling, err %d", err);
+	}
+
+	err = clock_gov_init();
+
+	if (err) {
+		LOG_ERR("Failed to init clock governor, err %d", err);
+	}
+
+	err = keymap_init();
+
+	if (err) {
+		LOG_ERR("Failed to init keymap, err %d", err);
+	}
+
+	err = stream_init();
+
+	if (err) {
+		LOG_ERR("Failed to init stream, err %d", err);
+	}
+
 	err = ble_init();
 
 	if (err) {
 		LOG_ERR("Failed to init BLE, err %d", err);
 	}
 
+	TELEMETRY_BOOT_PHASE(TELEMETRY_BOOT_BLE);
+
+	err = power_init();
+
+	if (err) {
+		LOG_ERR("Failed to init power management, err %d", err);
+	}
+
 	err = sense_init();
 
 	if (!err) {
-		k_thread_start(sampling_thread_id);
+		err = detect_init(&detector, &(detect_config_t) DETECT_CONFIG_DEFAULT, ARRAY_SIZE(touchpad_data));
+	}
+
+	TELEMETRY_BOOT_PHASE(TELEMETRY_BOOT_SENSE);
+
+	if (!err) {
+		LOG_INF("Start sampling");
+
+		TELEMETRY_SET(pad_count, ARRAY_SIZE(touchpad_data));
+
+		k_work_init_delayable(&scan_work, scan_process);
+		k_work_schedule_for_queue(&app_workq, &scan_work, K_MSEC(scan_interval_ms));
 	} else {
-		LOG_ERR("Failed to init sampling thread, err %d", err);
+		LOG_ERR("Failed to init sampling, err %d", err);
 	}
 	
 	LOG_INF("Startup complete");
 
-	led_blink(LED_INDEX_GREEN, LED_NORMAL_BLINK_DURATION);
+	bus_publish(&bus_ui_chan, &(bus_ui_msg_t) { .event = BUS_UI_READY });
 }
@@ -0,0 +1,164 @@
+/**
+ * @file    power.c
+ * @author  Matthijs Bakker
+ * @date    2026-10-18
+ * @brief   Idle detection and deep sleep
+ *
+ * When no BLE client is connected, USB is not attached and no pad has been
+ * touched for CONFIG_APP_SLEEP_IDLE_TIMEOUT_S seconds, the radio and LEDs are
+ * shut down and the sampling loop parks itself on the wake-up pad. Calibration
+ * stays in RAM, so scanning resumes right away after the wake-up. Attaching
+ * USB wakes the card up as well.
+ *
+ * The wake-up latency runs until the first report has been sent to a
+ * client, which includes reconnecting.
+ */
+
+#include "power.h"
+#include "app_workq.h"
+#include "ble.h"
+#include "bus.h"
+#include "sense.h"
+#include "telemetry.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+static struct k_work_delayable idle_work;
+static struct k_work usb_wake_work;
+
+static atomic_t ble_connections;
+static atomic_t usb_attached;
+static atomic_t sleep_requested;
+static atomic_t wakeup_time;    // of a touch without a report yet, 0 if none
+
+LOG_MODULE_REGISTER(power);
+
+static bool power_busy(void)
+{
+	return atomic_get(&ble_connections) || atomic_get(&usb_attached);
+}
+
+static void idle_handler(struct k_work *work)
+{
+	ARG_UNUSED(work);
+
+	if (power_busy()) {
+		return;
+	}
+
+	LOG_INF("Idle, entering deep sleep");
+
+	ble_suspend();
+
+	bus_publish(&bus_ui_chan, &(bus_ui_msg_t) { .event = BUS_UI_SLEEP });
+
+	TELEMETRY_INC(sleeps);
+
+	atomic_set(&sleep_requested, 1);
+}
+
+static void idle_restart(void)
+{
+	k_work_reschedule_for_queue(&app_workq, &idle_work, K_SECONDS(CONFIG_APP_SLEEP_IDLE_TIMEOUT_S));
+}
+
+// Runs on the queue of the sampling loop, so the wake-up pad is either armed or not yet
+static void usb_wake_handler(struct k_work *work)
+{
+	ARG_UNUSED(work);
+
+	if (!atomic_get(&sleep_requested)) {
+		return;
+	}
+
+	// Not armed yet, the sampling loop has not gone to sleep
+	if (sense_wake_fire()) {
+		power_wakeup();
+	}
+}
+
+int power_init(void)
+{
+	k_work_init_delayable(&idle_work, idle_handler);
+	k_work_init(&usb_wake_work, usb_wake_handler);
+
+	idle_restart();
+
+	return 0;
+}
+
+void power_usb_attached(bool attached)
+{
+	atomic_set(&usb_attached, attached);
+
+	if (!attached) {
+		idle_restart();
+		return;
+	}
+
+	k_work_submit_to_queue(&app_workq, &usb_wake_work);
+}
+
+bool power_sleep_requested(void)
+{
+	return atomic_get(&sleep_requested);
+}
+
+void power_wakeup(void)
+{
+	atomic_set(&sleep_requested, 0);
+
+	if (atomic_get(&usb_attached)) {
+		atomic_set(&wakeup_time, 0);
+		LOG_INF("Woken up by USB");
+	} else {
+		atomic_set(&wakeup_time, MAX(k_uptime_get_32(), 1));
+		LOG_INF("Woken up by touch");
+	}
+
+	ble_resume();
+	idle_restart();
+}
+
+void power_report_sent(void)
+{
+	uint32_t woken = atomic_set(&wakeup_time, 0);
+	uint32_t latency;
+
+	// Only the first report after a wake-up is timed
+	if (!woken) {
+		return;
+	}
+
+	latency = k_uptime_get_32() - woken;
+
+	TELEMETRY_SET(wake_report_last_ms, latency);
+	TELEMETRY_MAX(wake_report_max_ms, latency);
+
+	LOG_INF("Wake-to-first-report latency %u ms", latency);
+}
+
+static void touch_listener(const struct zbus_channel *chan)
+{
+	ARG_UNUSED(chan);
+
+	idle_restart();
+}
+
+static void conn_listener(const struct zbus_channel *chan)
+{
+	const bus_conn_msg_t *conn = zbus_chan_const_msg(chan);
+
+	atomic_set(&ble_connections, conn->connections);
+
+	if (!conn->connections) {
+		idle_restart();
+	}
+}
+
+ZBUS_LISTENER_DEFINE(power_touch_lis, touch_listener);
+ZBUS_CHAN_ADD_OBS(bus_touch_chan, power_touch_lis, 1);
+
+ZBUS_LISTENER_DEFINE(power_conn_lis, conn_listener);
+ZBUS_CHAN_ADD_OBS(bus_conn_chan, power_conn_lis, 0);
@@ -0,0 +1,52 @@
+/**
+ * @file    power.h
+ * @author  Matthijs Bakker
+ * @date    2026-10-18
+ * @brief   Idle detection and deep sleep
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <zephyr/sys/util.h>
+
+#if CONFIG_APP_SLEEP
+
+/**
+ * Start tracking idle time.
+ *
+ * @returns 0 on success,
+ *          >0 on failure
+ */
+int power_init(void);
+
+/**
+ * Report whether the USB cable is attached. Attaching wakes the card up.
+ */
+void power_usb_attached(bool attached);
+
+/**
+ * Whether the sampling loop should arm the wake-up pad and stop scanning.
+ */
+bool power_sleep_requested(void);
+
+/**
+ * Called by the sampling loop after the wake-up pad has fired.
+ * Restores the radio and restarts the idle timeout.
+ */
+void power_wakeup(void);
+
+/**
+ * Called once a report has been sent to a client, to time the wake-up.
+ */
+void power_report_sent(void);
+
+#else
+
+static inline int power_init(void) { return 0; }
+static inline void power_usb_attached(bool attached) { ARG_UNUSED(attached); }
+static inline bool power_sleep_requested(void) { return false; }
+static inline void power_wakeup(void) {}
+static inline void power_report_sent(void) {}
+
+#endif
@@ -0,0 +1,129 @@
+/**
+ * @file    recorder.c
+ * @author  Matthijs Bakker
+ * @date    2026-10-18
+ * @brief   Ring buffer of raw pad samples for offline replay
+ *
+ * The scan appends to the ring from the application work queue, the mass
+ * storage class reads it from its own thread. Both only hold the lock for
+ * a bounded copy, the scan never waits for the host.
+ */
+
+#include "recorder.h"
+
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/util.h>
+
+BUILD_ASSERT(sizeof(recorder_header_t) == 44, "Recording header layout changed");
+BUILD_ASSERT(sizeof(recorder_record_t) == 8, "Recording record layout changed");
+BUILD_ASSERT(IS_ENABLED(CONFIG_LITTLE_ENDIAN), "Recordings are stored little-endian");
+
+static recorder_record_t ring[CONFIG_APP_RECORDER_SAMPLES];
+static uint32_t head;               // total number of records ever written
+static recorder_header_t header = {
+	.magic = RECORDER_MAGIC,
+	.version = RECORDER_VERSION,
+};
+
+// Oldest and one past the newest record when the host started reading the file
+static uint32_t snapshot_tail;
+static uint32_t snapshot_head;
+
+static struct k_spinlock lock;
+
+static void append(uint8_t pad, uint16_t value, uint8_t flags)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	ring[head % CONFIG_APP_RECORDER_SAMPLES] = (recorder_record_t) {
+		.time_ms = k_uptime_get_32(),
+		.value = value,
+		.pad = pad,
+		.flags = flags,
+	};
+
+	++head;
+
+	k_spin_unlock(&lock, key);
+}
+
+void recorder_sample(uint8_t pad, uint32_t value, bool error)
+{
+	append(pad, MIN(value, UINT16_MAX), error ? RECORDER_FLAG_ERROR : 0);
+}
+
+void recorder_event(uint8_t pad, bool pressed)
+{
+	append(pad, 0, pressed ? RECORDER_FLAG_PRESS : RECORDER_FLAG_RELEASE);
+}
+
+void recorder_calibrated(const uint32_t *baselines, uint8_t pad_count)
+{
+	pad_count = MIN(pad_count, RECORDER_MAX_PADS);
+
+	memcpy(header.baselines, baselines, pad_count * sizeof(baselines[0]));
+	header.pad_count = pad_count;
+	header.calibrated = 1;
+}
+
+void recorder_read(uint8_t *buf, size_t offset, size_t size)
+{
+	k_spinlock_key_t key;
+	recorder_record_t record;
+	size_t index, chunk;
+	uint32_t position;
+
+	memset(buf, 0, size);
+
+	if (offset == 0) {
+		key = k_spin_lock(&lock);
+		snapshot_head = head;
+		snapshot_tail = head - MIN(head, CONFIG_APP_RECORDER_SAMPLES);
+		k_spin_unlock(&lock, key);
+	}
+
+	if (offset < sizeof(header)) {
+		recorder_header_t copy = header;
+
+		copy.record_count = snapshot_head - snapshot_tail;
+		chunk = MIN(size, sizeof(copy) - offset);
+
+		memcpy(buf, (uint8_t *)&copy + offset, chunk);
+
+		buf    += chunk;
+		offset += chunk;
+		size   -= chunk;
+	}
+
+	if (!size) {
+		return;
+	}
+
+	offset -= sizeof(header);
+
+	// Records are copied one at a time, so the scan is never held up for long
+	for (index = offset / sizeof(recorder_record_t); size && index < snapshot_head - snapshot_tail; ++index) {
+		size_t skip = offset % sizeof(recorder_record_t);
+
+		chunk = MIN(size, sizeof(recorder_record_t) - skip);
+		position = snapshot_tail + index;
+
+		key = k_spin_lock(&lock);
+
+		if (head - position <= CONFIG_APP_RECORDER_SAMPLES) {
+			record = ring[position % CONFIG_APP_RECORDER_SAMPLES];
+		} else {
+			record = (recorder_record_t) { .flags = RECORDER_FLAG_LOST };
+		}
+
+		k_spin_unlock(&lock, key);
+
+		memcpy(buf, (uint8_t *)&record + skip, chunk);
+
+		buf    += chunk;
+		offset += chunk;
+		size   -= chunk;
+	}
+}
@@ -0,0 +1,83 @@
+/**
+ * @file    recorder.h
+ * @author  Matthijs Bakker
+ * @date    2026-10-18
+ * @brief   Ring buffer of raw pad samples for offline replay
+ *
+ * Every sample the detector sees is kept in a RAM ring, together with the
+ * state changes it produced. The ring is rendered as RECORD.BIN on the mass
+ * storage drive: a recorder_header_t followed by record_count records,
+ * oldest first, all little-endian. tools/replay feeds recordings through
+ * the same detection code on the host.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define RECORDER_MAGIC              0x4d424352 // "MBCR"
+#define RECORDER_VERSION            1
+#define RECORDER_MAX_PADS           8
+
+#define RECORDER_FLAG_ERROR         0x01    // sample was used after all retries failed
+#define RECORDER_FLAG_PRESS         0x02    // state change, no sample value
+#define RECORDER_FLAG_RELEASE       0x04    // state change, no sample value
+#define RECORDER_FLAG_LOST          0x08    // overwritten while the file was read, no contents
+
+typedef struct {
+	uint32_t magic;
+	uint16_t version;
+	uint8_t pad_count;
+	uint8_t calibrated;         // baselines are valid
+	uint32_t record_count;
+	uint32_t baselines[RECORDER_MAX_PADS];
+} recorder_header_t;
+
+typedef struct {
+	uint32_t time_ms;
+	uint16_t value;             // oscillation period in TIMER1 ticks, saturated
+	uint8_t pad;
+	uint8_t flags;
+} recorder_record_t;
+
+#if CONFIG_APP_RECORDER
+
+#define RECORDER_FILE_SIZE \
+	(sizeof(recorder_header_t) + CONFIG_APP_RECORDER_SAMPLES * sizeof(recorder_record_t))
+
+/**
+ * Record the sample of a pad which was passed to the detector.
+ */
+void recorder_sample(uint8_t pad, uint32_t value, bool error);
+
+/**
+ * Record a state change accepted by the detector.
+ */
+void recorder_event(uint8_t pad, bool pressed);
+
+/**
+ * Store the calibrated baselines, one per pad.
+ */
+void recorder_calibrated(const uint32_t *baselines, uint8_t pad_count);
+
+/**
+ * Render part of the recording file.
+ *
+ * Reading from offset 0 takes a snapshot of the oldest and newest record,
+ * later reads continue from that snapshot. A record the scan overwrote
+ * since then reads with only RECORDER_FLAG_LOST set, so the file never
+ * mixes two passes of the ring. Bytes past the last record read as zero.
+ *
+ * @param buf       destination buffer
+ * @param offset    byte offset into the file
+ * @param size      number of bytes to render
+ */
+void recorder_read(uint8_t *buf, size_t offset, size_t size);
+
+#else
+
+static inline void recorder_sample(uint8_t pad, uint32_t value, bool error) {}
+static inline void recorder_event(uint8_t pad, bool pressed) {}
+static inline void recorder_calibrated(const uint32_t *baselines, uint8_t pad_count) {}
+
+#endif
@@ -5,23 +5,48 @@
  * @brief   
  */
 
+#include "sense.h"
+#include "energy.h"
+#include "health.h"
+#include "telemetry.h"
+
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
 #include <nrfx.h>
 
 K_SEM_DEFINE(sample_ready_sem, 0, 1);
 
+static sense_wake_handler_t wake_handler;
+static bool wake_armed;
+
 LOG_MODULE_REGISTER(sense);
 
 ISR_DIRECT_DECLARE(sample_ready_isr)
 {
+	HEALTH_ISR_ENTER();
+
 	if (NRF_COMP->EVENTS_CROSS) {
 		NRF_COMP->EVENTS_CROSS = 0;
 
 		LOG_DBG("Cross");
+		HEALTH_ISR_COUNT(sample_ready);
 
 		k_sem_give(&sample_ready_sem);
 		
+		ISR_DIRECT_PM();
+		HEALTH_ISR_EXIT(sample_ready);
+		return 1;
+	}
+
+	// COMP and LPCOMP share the interrupt, LPCOMP is only enabled during deep sleep
+	if (NRF_LPCOMP->EVENTS_UP) {
+		NRF_LPCOMP->EVENTS_UP = 0;
+		NRF_LPCOMP->INTENCLR  = LPCOMP_INTENCLR_UP_Msk;
+
+		if (wake_handler) {
+			wake_handler();
+		}
+
 		ISR_DIRECT_PM();
 		return 1;
 	}
@@ -32,17 +57,23 @@ ISR_DIRECT_DECLARE(sample_ready_isr)
 
 static void timer_overrun_isr(void *arg)
 {
+	HEALTH_ISR_ENTER();
+
 	ARG_UNUSED(arg);
 
 	if (NRF_TIMER1->EVENTS_COMPARE[1]) {
 		NRF_TIMER1->EVENTS_COMPARE[1] = 0;
 		NRF_TIMER1->TASKS_STOP = 1;
-		
+
+		HEALTH_ISR_COUNT(timer_overrun);
+
 		LOG_ERR("Timer overrun!");
 	}
+
+	HEALTH_ISR_EXIT(timer_overrun);
 }
 
-int sense_pin(int pin, uint32_t *value)
+int sense_pin(int pin, uint32_t timeout_ms, uint32_t *value)
 {
     int err;
 
@@ -51,32 +82,38 @@ int sense_pin(int pin, uint32_t *value)
 	
 	NRF_DPPIC->TASKS_CHG[0].EN = 1;
 
+	ENERGY_ON(SENSE);
+
 	NRF_COMP->PSEL = (pin << COMP_PSEL_PSEL_Pos);
 	NRF_COMP->ENABLE = (COMP_ENABLE_ENABLE_Enabled << COMP_ENABLE_ENABLE_Pos);
 	NRF_COMP->TASKS_START = 1;
 
 	// Await two COMP crossings before the wave period is in timer capture compare register
 
-	err = k_sem_take(&sample_ready_sem, K_MSEC(5));
+	err = k_sem_take(&sample_ready_sem, K_MSEC(timeout_ms));
 
     if (err) {
+        ENERGY_OFF(SENSE);
         LOG_DBG("Failed to capture first crossing, err %d", err);
         return 2;
     }
 
-	err = k_sem_take(&sample_ready_sem, K_MSEC(5));
+	err = k_sem_take(&sample_ready_sem, K_MSEC(timeout_ms));
 
     if (err) {
+        ENERGY_OFF(SENSE);
         LOG_ERR("Failed to capture second crossing, err %d", err);
         return 3;
     }
 
+	ENERGY_OFF(SENSE);
+
 	*value = NRF_TIMER1->CC[0];
 
     return 0;
 }
 
-int sense_init(void)
+static void comp_configure(void)
 {
 	NRF_COMP->REFSEL   = (COMP_REFSEL_REFSEL_VDD << COMP_REFSEL_REFSEL_Pos);
     NRF_COMP->TH       = (5 << COMP_TH_THDOWN_Pos) | (60 << COMP_TH_THUP_Pos);
@@ -109,6 +146,88 @@ int sense_init(void)
 	NRF_DPPIC->SUBSCRIBE_CHG[0].DIS = (0 << DPPIC_SUBSCRIBE_CHG_DIS_CHIDX_Pos) | DPPIC_SUBSCRIBE_CHG_DIS_EN_Msk;
 	NRF_DPPIC->SUBSCRIBE_CHG[1].EN  = (0 << DPPIC_SUBSCRIBE_CHG_EN_CHIDX_Pos)  | DPPIC_SUBSCRIBE_CHG_EN_EN_Msk;
 	NRF_DPPIC->SUBSCRIBE_CHG[1].DIS = (1 << DPPIC_SUBSCRIBE_CHG_DIS_CHIDX_Pos) | DPPIC_SUBSCRIBE_CHG_DIS_EN_Msk;
+}
+
+// A crossing left over from the other comparator would count as the first of the next sample
+static void crossings_discard(void)
+{
+	NRF_COMP->EVENTS_CROSS = 0;
+	k_sem_reset(&sample_ready_sem);
+}
+
+int sense_wake_arm(int pin, sense_wake_handler_t handler)
+{
+	wake_handler = handler;
+	wake_armed = true;
+
+	// LPCOMP shares its registers with COMP, so COMP must be off and unpublished
+	NRF_COMP->TASKS_STOP = 1;
+	NRF_COMP->ENABLE = (COMP_ENABLE_ENABLE_Disabled << COMP_ENABLE_ENABLE_Pos);
+	NRF_COMP->INTENCLR = COMP_INTEN_CROSS_Msk;
+
+	crossings_discard();
+
+	NRF_LPCOMP->PUBLISH_CROSS = 0;
+	NRF_LPCOMP->PUBLISH_UP    = 0;
+	NRF_LPCOMP->PUBLISH_DOWN  = 0;
+	NRF_LPCOMP->SUBSCRIBE_STOP = 0;
+
+	NRF_LPCOMP->PSEL      = (pin << LPCOMP_PSEL_PSEL_Pos);
+	NRF_LPCOMP->REFSEL    = (LPCOMP_REFSEL_REFSEL_Ref4_8Vdd << LPCOMP_REFSEL_REFSEL_Pos);
+	NRF_LPCOMP->ANADETECT = (LPCOMP_ANADETECT_ANADETECT_Up << LPCOMP_ANADETECT_ANADETECT_Pos);
+	NRF_LPCOMP->HYST      = (LPCOMP_HYST_HYST_Enabled << LPCOMP_HYST_HYST_Pos);
+	NRF_LPCOMP->EVENTS_UP = 0;
+	NRF_LPCOMP->INTENSET  = LPCOMP_INTENSET_UP_Msk;
+	NRF_LPCOMP->ENABLE    = (LPCOMP_ENABLE_ENABLE_Enabled << LPCOMP_ENABLE_ENABLE_Pos);
+	NRF_LPCOMP->TASKS_START = 1;
+
+	return 0;
+}
+
+void sense_wake_disarm(void)
+{
+	NRF_LPCOMP->TASKS_STOP = 1;
+	NRF_LPCOMP->INTENCLR   = LPCOMP_INTENCLR_UP_Msk;
+	NRF_LPCOMP->ENABLE     = (LPCOMP_ENABLE_ENABLE_Disabled << LPCOMP_ENABLE_ENABLE_Pos);
+	NRF_LPCOMP->EVENTS_UP  = 0;
+
+	wake_armed = false;
+
+	// LPCOMP crosses on every touch while armed, none of those are samples
+	crossings_discard();
+
+	comp_configure();
+}
+
+int sense_wake_fire(void)
+{
+	sense_wake_handler_t handler = NULL;
+	unsigned int key;
+
+	if (!wake_armed) {
+		return 1;
+	}
+
+	// Whoever clears the interrupt first calls the handler, a touch or the caller
+	key = irq_lock();
+
+	if (NRF_LPCOMP->INTEN & LPCOMP_INTEN_UP_Msk) {
+		NRF_LPCOMP->INTENCLR = LPCOMP_INTENCLR_UP_Msk;
+		handler = wake_handler;
+	}
+
+	irq_unlock(key);
+
+	if (handler) {
+		handler();
+	}
+
+	return 0;
+}
+
+int sense_init(void)
+{
+	comp_configure();
 
 	IRQ_DIRECT_CONNECT(COMP_LPCOMP_IRQn, 3, sample_ready_isr, 0);
 	irq_enable(COMP_LPCOMP_IRQn);
@@ -11,13 +11,48 @@
 /**
  * Blocking function to measure capacitance on the specified pin.
  * 
- * @param pin    x, where x is AINx (x in [0, 7])
- * @param value  location to store the measured value
+ * @param pin         x, where x is AINx (x in [0, 7])
+ * @param timeout_ms  time to wait for each comparator crossing
+ * @param value       location to store the measured value
  * 
  * @returns 0 on success,
  *          >0 on failure
  */
-int sense_pin(int pin, uint32_t *value);
+int sense_pin(int pin, uint32_t timeout_ms, uint32_t *value);
+
+/**
+ * Called from interrupt context when the armed pad is touched.
+ */
+typedef void (*sense_wake_handler_t)(void);
+
+/**
+ * Park the comparator on a single pad and call the handler once it is touched.
+ *
+ * LPCOMP is armed with hysteresis on the given analog input, so that the
+ * system can sleep. Sensing is unavailable until sense_wake_disarm()
+ * restores the regular configuration.
+ *
+ * @param pin      x, where x is AINx (x in [0, 7])
+ * @param handler  function to call from the ISR on touch
+ *
+ * @returns 0 on success,
+ *          >0 on failure
+ */
+int sense_wake_arm(int pin, sense_wake_handler_t handler);
+
+/**
+ * Stop LPCOMP and restore the regular sensing configuration.
+ */
+void sense_wake_disarm(void);
+
+/**
+ * Wake up as if the armed pad was touched, for wake-ups with another cause.
+ * Must be called from the thread which arms and disarms the pad.
+ *
+ * @returns 0 on success, also when the pad has fired already,
+ *          >0 if the pad is not armed
+ */
+int sense_wake_fire(void);
 
 /**
  * Initialize the capacitive sensing system.
@@ -0,0 +1,106 @@
+/**
+ * @file    slide.c
+ * @author  Matthijs Bakker
+ * @date    2026-10-18
+ * @brief   Swipe and slide detection across adjacent pads
+ */
+
+#include "slide.h"
+
+int slide_init(slide_t *slide, uint8_t pad_count)
+{
+	if (pad_count < 2 || pad_count > SLIDE_MAX_PADS) {
+		return 1;
+	}
+
+	*slide = (slide_t) {
+		.pad_count = pad_count,
+	};
+
+	return 0;
+}
+
+void slide_sample(slide_t *slide, uint8_t pad, uint32_t value, uint32_t threshold)
+{
+	uint32_t ratio;
+
+	if (pad >= slide->pad_count || !threshold) {
+		return;
+	}
+
+	ratio = (value << SLIDE_POS_SHIFT) / threshold;
+
+	slide->strength[pad] = (ratio > SLIDE_ACTIVE_LEVEL) ? ratio - SLIDE_ACTIVE_LEVEL : 0;
+}
+
+slide_event_type_t slide_scan_end(slide_t *slide, uint32_t now_us, slide_event_t *event)
+{
+	uint32_t total = 0;
+	uint32_t moment = 0;
+	int32_t pos, delta;
+	uint8_t i;
+
+	*event = (slide_event_t) {
+		.type = SLIDE_EVENT_NONE,
+		.end_us = now_us,
+	};
+
+	for (i = 0; i < slide->pad_count; ++i) {
+		total += slide->strength[i];
+		moment += (uint32_t)slide->strength[i] * i;
+	}
+
+	if (total < SLIDE_MIN_STRENGTH) {
+		if (!slide->touching) {
+			return SLIDE_EVENT_NONE;
+		}
+
+		slide->touching = false;
+		event->end_us = slide->last_us;
+		delta = slide->last_pos - slide->start_pos;
+		event->direction = (delta > 0) ? 1 : -1;
+
+		if (slide->sliding) {
+			event->type = SLIDE_EVENT_END;
+		} else if ((delta >= SLIDE_SWIPE_DISTANCE || -delta >= SLIDE_SWIPE_DISTANCE) &&
+			   slide->last_us - slide->start_us <= SLIDE_SWIPE_MAX_US) {
+			event->type = SLIDE_EVENT_SWIPE;
+		}
+
+		return event->type;
+	}
+
+	pos = (int32_t)((moment << SLIDE_POS_SHIFT) / total);
+
+	if (!slide->touching) {
+		slide->touching = true;
+		slide->sliding = false;
+		slide->start_pos = pos;
+		slide->step_origin = pos;
+		slide->start_us = now_us;
+	}
+
+	slide->last_pos = pos;
+	slide->last_us = now_us;
+
+	// Fast movement is left for the swipe check on release
+	if (now_us - slide->start_us < SLIDE_SLIDE_MIN_US) {
+		return SLIDE_EVENT_NONE;
+	}
+
+	delta = pos - slide->step_origin;
+
+	if (delta >= SLIDE_STEP || -delta >= SLIDE_STEP) {
+		event->type = SLIDE_EVENT_STEP;
+		event->direction = (delta > 0) ? 1 : -1;
+		slide->step_origin += event->direction * SLIDE_STEP;
+		slide->sliding = true;
+	}
+
+	return event->type;
+}
+
+bool slide_undecided(const slide_t *slide, uint32_t now_us)
+{
+	return slide->touching && !slide->sliding && now_us - slide->start_us < SLIDE_SWIPE_MAX_US;
+}
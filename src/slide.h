@@ -0,0 +1,83 @@
+/**
+ * @file    slide.h
+ * @author  Matthijs Bakker
+ * @date    2026-10-18
+ * @brief   Swipe and slide detection across adjacent pads
+ *
+ * The finger position is the centroid of the pad signals in Q8 pad
+ * pitches, computed once per scan from the samples the scan already took.
+ * A slow slide produces a step each time the position moves one pad
+ * pitch, a fast swipe produces a single event when the finger lifts.
+ *
+ * A touch is undecided until it has either rested for SLIDE_SWIPE_MAX_US or
+ * lifted without a swipe, the caller holds back key reports meanwhile.
+ *
+ * Plain C without Zephyr dependencies, all times are in microseconds.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SLIDE_MAX_PADS              8
+#define SLIDE_POS_SHIFT             8
+#define SLIDE_PITCH                 (1 << SLIDE_POS_SHIFT)
+
+#define SLIDE_ACTIVE_LEVEL          205     // Q8 ratio of sample to touch threshold, 0.8
+#define SLIDE_MIN_STRENGTH          64      // Q8 sum of all pads before there is a finger
+#define SLIDE_STEP                  SLIDE_PITCH
+#define SLIDE_SLIDE_MIN_US          250000  // movement before this is a swipe candidate
+#define SLIDE_SWIPE_MAX_US          300000
+#define SLIDE_SWIPE_DISTANCE        (SLIDE_PITCH * 3 / 2)
+
+typedef enum {
+	SLIDE_EVENT_NONE,
+	SLIDE_EVENT_STEP,           // slow slide moved by one pad pitch
+	SLIDE_EVENT_SWIPE,          // fast swipe ended
+	SLIDE_EVENT_END,            // finger lifted after one or more steps
+} slide_event_type_t;
+
+typedef struct {
+	slide_event_type_t type;
+	int8_t direction;           // +1 towards higher pad indices, -1 towards lower
+	uint32_t end_us;            // last scan which still saw the finger
+} slide_event_t;
+
+typedef struct {
+	uint8_t pad_count;
+	uint16_t strength[SLIDE_MAX_PADS];
+
+	bool touching;
+	bool sliding;
+	int32_t start_pos;
+	int32_t step_origin;
+	int32_t last_pos;
+	uint32_t start_us;
+	uint32_t last_us;
+} slide_t;
+
+/**
+ * Reset the detector for a row of pad_count pads, in physical order.
+ *
+ * @returns 0 on success,
+ *          >0 if there are too many or too few pads
+ */
+int slide_init(slide_t *slide, uint8_t pad_count);
+
+/**
+ * Record the sample of a single pad in the current scan.
+ */
+void slide_sample(slide_t *slide, uint8_t pad, uint32_t value, uint32_t threshold);
+
+/**
+ * Evaluate the samples of a finished scan.
+ *
+ * @returns the type of the event stored in event
+ */
+slide_event_type_t slide_scan_end(slide_t *slide, uint32_t now_us, slide_event_t *event);
+
+/**
+ * Whether the finger seen by the last scan may still become a slide or a swipe.
+ *
+ * @returns true while the finger is down, not sliding and younger than SLIDE_SWIPE_MAX_US
+ */
+bool slide_undecided(const slide_t *slide, uint32_t now_us);
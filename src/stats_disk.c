@@ -0,0 +1,508 @@
+/**
+ * @file    stats_disk.c
+ * @author  Matthijs Bakker
+ * @date    2026-10-18
+ * @brief   Disk overlay which serves live telemetry files
+ *
+ * The stats files are regular files on the FAT volume, created with a fixed
+ * size at boot. This overlay sits between the USB mass storage class and the
+ * backing disk, and replaces the data sectors of those files when the host
+ * reads them. Nothing is rendered until the host actually reads the file.
+ * Host writes to those sectors fail with an I/O error.
+ *
+ * The sectors of a file are found by following its cluster chain on the
+ * backing disk, so the file system code is not involved. A read of the first
+ * sector of a file renders a snapshot, which serves all its other sectors, so
+ * that a host reading the file in several requests sees a consistent copy.
+ */
+
+#include "stats_disk.h"
+#include "cache_prof.h"
+#include "clock_gov.h"
+#include "recorder.h"
+#include "telemetry.h"
+#include "trace_buffer.h"
+
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/storage/disk_access.h>
+#include <zephyr/drivers/disk.h>
+#include <zephyr/sys/byteorder.h>
+
+#define SECTOR_SIZE                 512
+#define MAX_EXTENTS                 4       // fragments of a stats file on the volume
+
+typedef struct {
+	uint32_t first_sector;      // on the backing disk
+	uint32_t sector_count;
+} stats_extent_t;
+
+typedef struct {
+	stats_extent_t extents[MAX_EXTENTS];
+	uint8_t extent_count;
+	uint32_t sector_count;
+} stats_file_map_t;
+
+// Layout of the FAT12 or FAT16 volume on the backing disk, in sectors
+typedef struct {
+	uint32_t base;
+	uint32_t fat_start;
+	uint32_t root_start;
+	uint32_t root_sectors;
+	uint32_t data_start;
+	uint32_t cluster_sectors;
+	uint32_t cluster_count;
+	bool fat16;
+} fat_volume_t;
+
+static const char *backing_disk;
+static stats_file_map_t file_map[__STATS_FILE_MAX];
+
+// Files are rendered once per read of their first sector, the rest is served from here
+static uint8_t text_snapshot[ROUND_UP(CONFIG_APP_STATS_FILE_SIZE, SECTOR_SIZE)] __aligned(4);
+#if CONFIG_APP_STATS_FILE_BINARY
+static uint8_t bin_snapshot[STATS_DISK_BIN_SIZE] __aligned(4);
+#endif
+static bool snapshot_valid[__STATS_FILE_MAX];
+
+// The text snapshot is not valid before the first read, mapping borrows it as sector buffer
+static uint8_t *const scratch = text_snapshot;
+
+BUILD_ASSERT(sizeof(text_snapshot) >= SECTOR_SIZE);
+// The 12 byte header of telemetry_format_bin() and the whole telemetry
+BUILD_ASSERT(12 + sizeof(telemetry_t) <= STATS_DISK_BIN_SIZE);
+
+K_MUTEX_DEFINE(render_lock);
+
+LOG_MODULE_REGISTER(stats_disk);
+
+static void snapshot_take(stats_file_t file)
+{
+	switch (file) {
+		case STATS_FILE_TEXT:
+			telemetry_format_text((char *)text_snapshot, file_map[file].sector_count * SECTOR_SIZE);
+			break;
+#if CONFIG_APP_STATS_FILE_BINARY
+		case STATS_FILE_BINARY:
+			telemetry_format_bin(bin_snapshot, sizeof(bin_snapshot));
+			break;
+#endif
+		default:
+			// The recorder snapshots its ring itself when offset 0 is read
+			break;
+	}
+
+	snapshot_valid[file] = true;
+}
+
+static void file_read(stats_file_t file, uint8_t *buf, size_t offset, size_t size)
+{
+	switch (file) {
+		case STATS_FILE_TEXT:
+			memcpy(buf, &text_snapshot[offset], size);
+			break;
+#if CONFIG_APP_STATS_FILE_BINARY
+		case STATS_FILE_BINARY:
+			memcpy(buf, &bin_snapshot[offset], size);
+			break;
+#endif
+#if CONFIG_APP_RECORDER
+		case STATS_FILE_RECORDING:
+			// The recording is too large for a snapshot, it is copied straight out of the ring
+			recorder_read(buf, offset, size);
+			break;
+#endif
+#if CONFIG_APP_TRACE_FILE
+		case STATS_FILE_TRACE:
+			// Served live, the part beyond the capture reads as zeros
+			trace_buffer_read(buf, offset, size);
+			break;
+#endif
+		default:
+			memset(buf, 0, size);
+			break;
+	}
+}
+
+static bool map_overlaps(const stats_file_map_t *map, uint32_t sector, uint32_t count)
+{
+	int e;
+
+	for (e = 0; e < map->extent_count; ++e) {
+		const stats_extent_t *extent = &map->extents[e];
+
+		if (sector < extent->first_sector + extent->sector_count &&
+		    extent->first_sector < sector + count) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static int disk_stats_init(struct disk_info *disk)
+{
+	ARG_UNUSED(disk);
+
+	return disk_access_init(backing_disk);
+}
+
+static int disk_stats_status(struct disk_info *disk)
+{
+	ARG_UNUSED(disk);
+
+	return disk_access_status(backing_disk);
+}
+
+static int disk_stats_read(struct disk_info *disk, uint8_t *buf, uint32_t sector, uint32_t count)
+{
+	const stats_file_map_t *map;
+	uint32_t first, last, file_start, file_sector;
+	int i, e, err;
+
+	CACHE_PROF_BEGIN(MSC_READ);
+	clock_gov_boost();
+
+	err = disk_access_read(backing_disk, buf, sector, count);
+
+	if (err) {
+		clock_gov_release();
+		CACHE_PROF_END(MSC_READ);
+		return err;
+	}
+
+	for (i = 0; i < __STATS_FILE_MAX; ++i) {
+		map = &file_map[i];
+
+		if (!map_overlaps(map, sector, count)) {
+			continue;
+		}
+
+		k_mutex_lock(&render_lock, K_FOREVER);
+
+		// Hosts read a file from its first sector after opening it
+		file_start = map->extents[0].first_sector;
+
+		if (!snapshot_valid[i] || (file_start >= sector && file_start < sector + count)) {
+			snapshot_take(i);
+		}
+
+		file_sector = 0;
+
+		for (e = 0; e < map->extent_count; file_sector += map->extents[e++].sector_count) {
+			const stats_extent_t *extent = &map->extents[e];
+
+			first = MAX(sector, extent->first_sector);
+			last  = MIN(sector + count, extent->first_sector + extent->sector_count);
+
+			if (first >= last) {
+				continue;
+			}
+
+			file_read(i, &buf[(first - sector) * SECTOR_SIZE],
+				  (file_sector + first - extent->first_sector) * SECTOR_SIZE,
+				  (last - first) * SECTOR_SIZE);
+		}
+
+		k_mutex_unlock(&render_lock);
+	}
+
+	clock_gov_release();
+	CACHE_PROF_END(MSC_READ);
+
+	return 0;
+}
+
+static int disk_stats_write(struct disk_info *disk, const uint8_t *buf, uint32_t sector, uint32_t count)
+{
+	const stats_extent_t *extent;
+	int i, e, err;
+
+	// Sectors before a read-only file are written, the file itself fails the write
+	while (count) {
+		uint32_t chunk = count;
+		bool mapped = false;
+
+		for (i = 0; i < __STATS_FILE_MAX && !mapped; ++i) {
+			for (e = 0; e < file_map[i].extent_count; ++e) {
+				extent = &file_map[i].extents[e];
+
+				if (sector >= extent->first_sector && sector < extent->first_sector + extent->sector_count) {
+					mapped = true;
+					break;
+				}
+
+				if (sector < extent->first_sector) {
+					chunk = MIN(chunk, extent->first_sector - sector);
+				}
+			}
+		}
+
+		// Dropping the data silently would lose it once FAT reuses the clusters of a deleted file
+		if (mapped) {
+			LOG_WRN("Write to read-only file sector %u rejected", sector);
+			return -EIO;
+		}
+
+		err = disk_access_write(backing_disk, buf, sector, chunk);
+
+		if (err) {
+			return err;
+		}
+
+		buf    += chunk * SECTOR_SIZE;
+		sector += chunk;
+		count  -= chunk;
+	}
+
+	return 0;
+}
+
+static int disk_stats_ioctl(struct disk_info *disk, uint8_t cmd, void *buf)
+{
+	ARG_UNUSED(disk);
+
+	return disk_access_ioctl(backing_disk, cmd, buf);
+}
+
+static const struct disk_operations disk_stats_ops = {
+	.init = disk_stats_init,
+	.status = disk_stats_status,
+	.read = disk_stats_read,
+	.write = disk_stats_write,
+	.ioctl = disk_stats_ioctl,
+};
+
+static struct disk_info disk_stats = {
+	.name = STATS_DISK_NAME,
+	.ops = &disk_stats_ops,
+};
+
+int stats_disk_init(const char *backing)
+{
+	int err;
+
+	backing_disk = backing;
+
+	err = disk_access_register(&disk_stats);
+
+	if (err) {
+		LOG_ERR("Failed to register stats disk, err %d", err);
+		return 1;
+	}
+
+	return 0;
+}
+
+static int fat_volume_read(fat_volume_t *vol)
+{
+	uint32_t reserved, fat_count, root_entries, total, fat_size;
+	int err;
+
+	*vol = (fat_volume_t) {0};
+
+	err = disk_access_read(backing_disk, scratch, 0, 1);
+
+	if (err) {
+		return err;
+	}
+
+	// A partitioned disk has the volume in the first partition
+	if (sys_get_le16(&scratch[11]) != SECTOR_SIZE && scratch[450]) {
+		vol->base = sys_get_le32(&scratch[454]);
+
+		err = disk_access_read(backing_disk, scratch, vol->base, 1);
+
+		if (err) {
+			return err;
+		}
+	}
+
+	reserved     = sys_get_le16(&scratch[14]);
+	fat_count    = scratch[16];
+	root_entries = sys_get_le16(&scratch[17]);
+	total        = sys_get_le16(&scratch[19]) ?: sys_get_le32(&scratch[32]);
+	fat_size     = sys_get_le16(&scratch[22]);
+
+	// FAT32 has no fixed root directory, the RAM disk is never that large
+	if (sys_get_le16(&scratch[11]) != SECTOR_SIZE || !scratch[13] || !fat_size) {
+		return -ENOTSUP;
+	}
+
+	vol->cluster_sectors = scratch[13];
+	vol->fat_start       = vol->base + reserved;
+	vol->root_start      = vol->fat_start + fat_count * fat_size;
+	vol->root_sectors    = DIV_ROUND_UP(root_entries * 32, SECTOR_SIZE);
+	vol->data_start      = vol->root_start + vol->root_sectors;
+	vol->cluster_count   = (vol->base + total - vol->data_start) / vol->cluster_sectors;
+	vol->fat16           = vol->cluster_count >= 4085;
+
+	return 0;
+}
+
+static int fat_byte(const fat_volume_t *vol, uint32_t offset, uint32_t *cached, uint8_t *value)
+{
+	uint32_t sector = vol->fat_start + offset / SECTOR_SIZE;
+	int err;
+
+	if (sector != *cached) {
+		err = disk_access_read(backing_disk, scratch, sector, 1);
+
+		if (err) {
+			return err;
+		}
+
+		*cached = sector;
+	}
+
+	*value = scratch[offset % SECTOR_SIZE];
+
+	return 0;
+}
+
+static int fat_next(const fat_volume_t *vol, uint32_t cluster, uint32_t *cached, uint32_t *next)
+{
+	uint32_t offset = vol->fat16 ? cluster * 2 : cluster + cluster / 2;
+	uint8_t lo, hi;
+	int err;
+
+	err = fat_byte(vol, offset, cached, &lo);
+	err = err ?: fat_byte(vol, offset + 1, cached, &hi);
+
+	if (err) {
+		return err;
+	}
+
+	*next = lo | (hi << 8);
+
+	if (!vol->fat16) {
+		*next = (cluster & 1) ? *next >> 4 : *next & 0xFFF;
+	}
+
+	return 0;
+}
+
+// "STATS.TXT" to the space padded "STATS   TXT" of a short directory entry
+static void fat_short_name(const char *filename, char name[11])
+{
+	const char *dot = strchr(filename, '.');
+	size_t base = dot ? (size_t)(dot - filename) : strlen(filename);
+
+	memset(name, ' ', 11);
+	memcpy(name, filename, MIN(base, 8));
+
+	if (dot) {
+		memcpy(&name[8], dot + 1, MIN(strlen(dot + 1), 3));
+	}
+}
+
+static int fat_find(const fat_volume_t *vol, const char *filename, uint32_t *cluster, uint32_t *size)
+{
+	char name[11];
+	uint32_t s;
+	int i, err;
+
+	fat_short_name(filename, name);
+
+	for (s = 0; s < vol->root_sectors; ++s) {
+		err = disk_access_read(backing_disk, scratch, vol->root_start + s, 1);
+
+		if (err) {
+			return err;
+		}
+
+		for (i = 0; i < SECTOR_SIZE; i += 32) {
+			const uint8_t *entry = &scratch[i];
+
+			if (!entry[0]) {
+				return -ENOENT;
+			}
+
+			// Deleted entries, long name fragments and volume labels
+			if (entry[0] == 0xE5 || (entry[11] & 0x08) || memcmp(entry, name, sizeof(name))) {
+				continue;
+			}
+
+			*cluster = sys_get_le16(&entry[26]);
+			*size = sys_get_le32(&entry[28]);
+
+			return 0;
+		}
+	}
+
+	return -ENOENT;
+}
+
+int stats_disk_map(stats_file_t file, const char *filename)
+{
+	stats_file_map_t map = {0};
+	uint32_t cluster, size, sector, sectors, i;
+	uint32_t cached = UINT32_MAX;
+	fat_volume_t vol;
+	int err;
+
+	k_mutex_lock(&render_lock, K_FOREVER);
+
+	err = fat_volume_read(&vol);
+	err = err ?: fat_find(&vol, filename, &cluster, &size);
+
+	if (err || !size) {
+		k_mutex_unlock(&render_lock);
+		LOG_ERR("Stats file %s not found on the volume, err %d", filename, err);
+		return 1;
+	}
+
+	sectors = DIV_ROUND_UP(size, SECTOR_SIZE);
+
+	// Follow the cluster chain, the file is not necessarily contiguous
+	for (i = 0; map.sector_count < sectors && i < vol.cluster_count; ++i) {
+		if (cluster < 2 || cluster >= vol.cluster_count + 2) {
+			break;
+		}
+
+		sector = vol.data_start + (cluster - 2) * vol.cluster_sectors;
+
+		if (map.extent_count && sector == map.extents[map.extent_count - 1].first_sector +
+		    map.extents[map.extent_count - 1].sector_count) {
+			map.extents[map.extent_count - 1].sector_count += vol.cluster_sectors;
+		} else if (map.extent_count < MAX_EXTENTS) {
+			map.extents[map.extent_count++] = (stats_extent_t) { sector, vol.cluster_sectors };
+		} else {
+			break;
+		}
+
+		map.sector_count += vol.cluster_sectors;
+
+		err = fat_next(&vol, cluster, &cached, &cluster);
+
+		if (err) {
+			break;
+		}
+	}
+
+	k_mutex_unlock(&render_lock);
+
+	if (map.sector_count < sectors) {
+		LOG_ERR("Cluster chain of stats file %s is broken or too fragmented", filename);
+		return 2;
+	}
+
+	// The last cluster may reach past the end of the file
+	map.extents[map.extent_count - 1].sector_count -= map.sector_count - sectors;
+	map.sector_count = sectors;
+
+	if ((file == STATS_FILE_TEXT && sectors * SECTOR_SIZE > sizeof(text_snapshot)) ||
+	    (file == STATS_FILE_BINARY && sectors * SECTOR_SIZE > STATS_DISK_BIN_SIZE)) {
+		LOG_ERR("Stats file %s does not fit its snapshot", filename);
+		return 3;
+	}
+
+	file_map[file] = map;
+
+	LOG_INF("Stats file %s at sector %u (%u sectors, %u extents)", filename,
+		map.extents[0].first_sector, sectors, map.extent_count);
+
+	return 0;
+}
@@ -0,0 +1,45 @@
+/**
+ * @file    stats_disk.h
+ * @author  Matthijs Bakker
+ * @date    2026-10-18
+ * @brief   Disk overlay which serves live telemetry files
+ */
+
+#include <stdint.h>
+
+#define STATS_DISK_NAME             "STATS"
+#define STATS_DISK_BIN_SIZE         1024
+
+typedef enum {
+	STATS_FILE_TEXT,
+	STATS_FILE_BINARY,
+	STATS_FILE_RECORDING,
+	STATS_FILE_TRACE,
+
+	__STATS_FILE_MAX,
+} stats_file_t;
+
+/**
+ * Register the "STATS" disk, which forwards all access to the backing disk
+ * except for the sectors of the stats files. Those are rendered from the
+ * live counters whenever the host reads the first sector of a file, and
+ * writes to them are discarded.
+ *
+ * @param backing name of the disk which holds the file system
+ *
+ * @returns 0 on success,
+ *          >0 on failure
+ */
+int stats_disk_init(const char *backing);
+
+/**
+ * Look up the sectors of a stats file in the root directory of the FAT12 or
+ * FAT16 volume on the backing disk. The file must be closed.
+ *
+ * @param file      which file the sectors belong to
+ * @param filename  short name of the file, like "STATS.TXT"
+ *
+ * @returns 0 on success,
+ *          >0 if the file is not found, too fragmented or too large
+ */
+int stats_disk_map(stats_file_t file, const char *filename);
@@ -0,0 +1,317 @@
+/**
+ * @file    stream.c
+ * @author  Matthijs Bakker
+ * @date    2026-10-18
+ * @brief   Raw pad data streaming over a vendor GATT service
+ *
+ * Every complete scan becomes a frame: the low 16 bits of the uptime in
+ * milliseconds followed by the period of every pad, all little-endian
+ * uint16. Frames are batched until the next one would not fit the ATT MTU
+ * of the subscribers, and sent behind a stream_header_t. Gaps in the
+ * sequence numbers are frames which were dropped, which includes every
+ * frame while a subscriber has an MTU too small for a single one.
+ *
+ * HID reports share the ATT TX buffers with the stream. The stream never
+ * has more than CONFIG_APP_STREAM_MAX_IN_FLIGHT notifications queued, so
+ * the remaining buffers are always free for HIDS. A batch which cannot be
+ * sent is dropped rather than delaying the scan or a report.
+ */
+
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
+
+#include <zephyr/bluetooth/att.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/gatt.h>
+#include <zephyr/bluetooth/uuid.h>
+
+#include "app_workq.h"
+#include "bus.h"
+#include "stream.h"
+#include "telemetry.h"
+
+#define BT_UUID_STREAM_SERVICE_VAL \
+	BT_UUID_128_ENCODE(0x6d626373, 0x7472, 0x6561, 0x6d00, 0x000000000001)
+#define BT_UUID_STREAM_CHRC_VAL \
+	BT_UUID_128_ENCODE(0x6d626373, 0x7472, 0x6561, 0x6d00, 0x000000000002)
+
+#define STREAM_MAX_PADS             8
+#define STREAM_ATT_OVERHEAD         3       // opcode + handle of a notification
+#define STREAM_MIN_PAYLOAD          (BT_ATT_DEFAULT_LE_MTU - STREAM_ATT_OVERHEAD)
+#define STREAM_MAX_PAYLOAD          (CONFIG_BT_L2CAP_TX_MTU - STREAM_ATT_OVERHEAD)
+#define STREAM_FRAME_SIZE(pads)     ((1 + (pads)) * sizeof(uint16_t))
+
+BUILD_ASSERT(CONFIG_APP_STREAM_MAX_IN_FLIGHT < CONFIG_BT_ATT_TX_COUNT,
+	     "The stream must leave ATT TX buffers for HID reports");
+
+typedef struct __packed {
+	uint8_t pad_count;
+	uint8_t frame_count;
+	uint16_t sequence;          // sequence number of the first frame
+} stream_header_t;
+
+// A batch never grows beyond the payload size, which is at most the size of the buffer
+BUILD_ASSERT(sizeof(stream_header_t) + STREAM_FRAME_SIZE(STREAM_MAX_PADS) <= STREAM_MAX_PAYLOAD,
+	     "A frame of every pad must fit the largest notification, see overlay-stream.conf");
+
+typedef struct {
+	uint16_t payload_size;      // smallest MTU of all subscribers, minus overhead
+	uint8_t subscribers;
+} stream_target_t;
+
+static uint8_t batch[STREAM_MAX_PAYLOAD];
+static size_t batch_len;
+static bool batch_full;
+
+static uint16_t frame[1 + STREAM_MAX_PADS];
+static uint16_t sequence;
+static uint16_t payload_size = STREAM_MIN_PAYLOAD;
+static bool subscribed;
+
+static atomic_t in_flight;
+
+// Connections which were moved to the 2M PHY for the stream, by connection index
+static bool phy_2m[CONFIG_BT_MAX_CONN];
+
+static void flush_process(struct k_work *work);
+static void link_process(struct k_work *work);
+
+static K_WORK_DEFINE(flush_work, flush_process);
+static K_WORK_DEFINE(link_work, link_process);
+
+LOG_MODULE_REGISTER(stream);
+
+static void ccc_changed(const struct bt_gatt_attr *attr, uint16_t value)
+{
+	ARG_UNUSED(attr);
+
+	subscribed = (value == BT_GATT_CCC_NOTIFY);
+
+	// Link parameters are updated per connection, which the CCC callback does not know
+	k_work_submit_to_queue(&app_workq, &link_work);
+}
+
+BT_GATT_SERVICE_DEFINE(stream_svc,
+	BT_GATT_PRIMARY_SERVICE(BT_UUID_DECLARE_128(BT_UUID_STREAM_SERVICE_VAL)),
+	BT_GATT_CHARACTERISTIC(BT_UUID_DECLARE_128(BT_UUID_STREAM_CHRC_VAL),
+			       BT_GATT_CHRC_NOTIFY,
+			       BT_GATT_PERM_NONE,
+			       NULL, NULL, NULL),
+	BT_GATT_CCC(ccc_changed, BT_GATT_PERM_READ_AUTHEN | BT_GATT_PERM_WRITE_AUTHEN),
+);
+
+static bool is_subscriber(struct bt_conn *conn)
+{
+	return bt_gatt_is_subscribed(conn, &stream_svc.attrs[2], BT_GATT_CCC_NOTIFY);
+}
+
+static void link_update(struct bt_conn *conn, void *data)
+{
+	stream_target_t *target = data;
+	uint8_t index = bt_conn_index(conn);
+	uint16_t mtu = bt_gatt_get_mtu(conn);
+	int err;
+
+	if (!is_subscriber(conn)) {
+		// Only a former subscriber goes back, the PHY of other centrals is theirs to choose
+		if (phy_2m[index]) {
+			phy_2m[index] = false;
+			bt_conn_le_phy_update(conn, BT_CONN_LE_PHY_PARAM_1M);
+		}
+		return;
+	}
+
+	err = bt_conn_le_data_len_update(conn, BT_LE_DATA_LEN_PARAM_MAX);
+
+	if (err && err != -EALREADY) {
+		LOG_WRN("Data length update failed, err %d", err);
+	}
+
+	err = bt_conn_le_phy_update(conn, BT_CONN_LE_PHY_PARAM_2M);
+
+	if (err && err != -EALREADY) {
+		LOG_WRN("PHY update failed, err %d", err);
+	} else {
+		phy_2m[index] = true;
+	}
+
+	// Until the MTU is known, assume the default
+	mtu = MAX(mtu, BT_ATT_DEFAULT_LE_MTU);
+
+	target->payload_size = MIN(target->payload_size, mtu - STREAM_ATT_OVERHEAD);
+	++target->subscribers;
+}
+
+static void link_process(struct k_work *work)
+{
+	stream_target_t target = {
+		.payload_size = STREAM_MAX_PAYLOAD,
+	};
+
+	ARG_UNUSED(work);
+
+	bt_conn_foreach(BT_CONN_TYPE_LE, link_update, &target);
+
+	payload_size = target.subscribers ? target.payload_size : STREAM_MIN_PAYLOAD;
+	batch_len = 0;
+	batch_full = false;
+
+	LOG_INF("%u subscribers, %u bytes per notification", target.subscribers, payload_size);
+}
+
+static void mtu_updated(struct bt_conn *conn, uint16_t tx, uint16_t rx)
+{
+	ARG_UNUSED(conn);
+	ARG_UNUSED(tx);
+	ARG_UNUSED(rx);
+
+	// The exchange usually completes after the subscription, the batches grow with it
+	k_work_submit_to_queue(&app_workq, &link_work);
+}
+
+static struct bt_gatt_cb gatt_callbacks = {
+	.att_mtu_updated = mtu_updated,
+};
+
+static void disconnected(struct bt_conn *conn, uint8_t reason)
+{
+	ARG_UNUSED(reason);
+
+	phy_2m[bt_conn_index(conn)] = false;
+
+	// The batch size may have been limited by this connection
+	k_work_submit_to_queue(&app_workq, &link_work);
+}
+
+BT_CONN_CB_DEFINE(stream_conn_callbacks) = {
+	.disconnected = disconnected,
+};
+
+static void notify_complete(struct bt_conn *conn, void *user_data)
+{
+	ARG_UNUSED(conn);
+	ARG_UNUSED(user_data);
+
+	atomic_dec(&in_flight);
+}
+
+static void notify_subscriber(struct bt_conn *conn, void *data)
+{
+	struct bt_gatt_notify_params params = {
+		.attr = &stream_svc.attrs[2],
+		.data = batch,
+		.len = batch_len,
+		.func = notify_complete,
+	};
+	bool *sent = data;
+	int err;
+
+	if (!is_subscriber(conn)) {
+		return;
+	}
+
+	if (atomic_inc(&in_flight) >= CONFIG_APP_STREAM_MAX_IN_FLIGHT) {
+		atomic_dec(&in_flight);
+		return;
+	}
+
+	err = bt_gatt_notify_cb(conn, &params);
+
+	if (err) {
+		atomic_dec(&in_flight);
+		return;
+	}
+
+	*sent = true;
+}
+
+static void flush_process(struct k_work *work)
+{
+	const stream_header_t *header = (const stream_header_t *)batch;
+	bool sent = false;
+
+	ARG_UNUSED(work);
+
+	if (!batch_full) {
+		return;
+	}
+
+	bt_conn_foreach(BT_CONN_TYPE_LE, notify_subscriber, &sent);
+
+	if (sent) {
+		TELEMETRY_INC(stream_notifications);
+		TELEMETRY_ADD(stream_bytes, batch_len);
+	} else {
+		TELEMETRY_ADD(stream_frames_dropped, header->frame_count);
+	}
+
+	batch_len = 0;
+	batch_full = false;
+}
+
+static void frame_append(uint8_t pad_count)
+{
+	stream_header_t *header = (stream_header_t *)batch;
+	size_t frame_size = STREAM_FRAME_SIZE(pad_count);
+
+	TELEMETRY_INC(stream_frames);
+
+	// The previous batch is still waiting for the work queue, or the frame does not fit the MTU
+	if (batch_full || sizeof(*header) + frame_size > payload_size) {
+		TELEMETRY_INC(stream_frames_dropped);
+		++sequence;
+		return;
+	}
+
+	if (!batch_len) {
+		*header = (stream_header_t) {
+			.pad_count = pad_count,
+			.sequence = sys_cpu_to_le16(sequence),
+		};
+
+		batch_len = sizeof(*header);
+	}
+
+	memcpy(&batch[batch_len], frame, frame_size);
+	batch_len += frame_size;
+	++header->frame_count;
+	++sequence;
+
+	if (batch_len + frame_size > payload_size) {
+		batch_full = true;
+		k_work_submit_to_queue(&app_workq, &flush_work);
+	}
+}
+
+static void pad_raw_listener(const struct zbus_channel *chan)
+{
+	const bus_pad_raw_msg_t *raw = zbus_chan_const_msg(chan);
+
+	if (!subscribed || raw->pad_count > STREAM_MAX_PADS) {
+		return;
+	}
+
+	if (raw->pad == 0) {
+		frame[0] = sys_cpu_to_le16((uint16_t)k_uptime_get_32());
+	}
+
+	frame[1 + raw->pad] = sys_cpu_to_le16(MIN(raw->value, UINT16_MAX));
+
+	if (raw->pad == raw->pad_count - 1) {
+		frame_append(raw->pad_count);
+	}
+}
+
+ZBUS_LISTENER_DEFINE(stream_pad_raw_lis, pad_raw_listener);
+ZBUS_CHAN_ADD_OBS(bus_pad_raw_chan, stream_pad_raw_lis, 2);
+
+int stream_init(void)
+{
+	bt_gatt_cb_register(&gatt_callbacks);
+
+	return 0;
+}
@@ -0,0 +1,22 @@
+/**
+ * @file    stream.h
+ * @author  Matthijs Bakker
+ * @date    2026-10-18
+ * @brief   Raw pad data streaming over a vendor GATT service
+ */
+
+#if CONFIG_APP_STREAM
+
+/**
+ * Follow the ATT MTU of the subscribers. The service itself is static.
+ *
+ * @returns 0 on success,
+ *          >0 on failure
+ */
+int stream_init(void);
+
+#else
+
+static inline int stream_init(void) { return 0; }
+
+#endif
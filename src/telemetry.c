@@ -0,0 +1,309 @@
+/**
+ * @file    telemetry.c
+ * @author  Matthijs Bakker
+ * @date    2026-10-18
+ * @brief   Live runtime counters
+ */
+
+#include "telemetry.h"
+#include "bus.h"
+#include "energy.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/byteorder.h>
+
+#define TELEMETRY_BIN_MAGIC         0x4d424354 // "MBCT"
+#define TELEMETRY_BIN_VERSION       3
+
+typedef struct __packed {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t length;
+	uint32_t uptime_ms;
+} telemetry_bin_header_t;
+
+static const char *const boot_phase_names[] = {
+	[TELEMETRY_BOOT_USBMS]      = "usbms",
+	[TELEMETRY_BOOT_BLE]        = "ble",
+	[TELEMETRY_BOOT_SENSE]      = "sense",
+	[TELEMETRY_BOOT_CALIBRATED] = "calibrated",
+};
+
+BUILD_ASSERT(ARRAY_SIZE(boot_phase_names) == __TELEMETRY_BOOT_MAX);
+
+static const char *const energy_consumer_names[] = {
+	[TELEMETRY_ENERGY_SCAN]         = "scan",
+	[TELEMETRY_ENERGY_SENSE]        = "sense",
+	[TELEMETRY_ENERGY_LED]          = "led",
+	[TELEMETRY_ENERGY_ADVERTISING]  = "advertising",
+	[TELEMETRY_ENERGY_CONNECTION]   = "connection",
+};
+
+BUILD_ASSERT(ARRAY_SIZE(energy_consumer_names) == __TELEMETRY_ENERGY_MAX);
+
+static const char *const cache_region_names[] = {
+	[TELEMETRY_CACHE_SCAN]      = "scan",
+	[TELEMETRY_CACHE_DETECT]    = "detect",
+	[TELEMETRY_CACHE_HID_SEND]  = "hid_send",
+	[TELEMETRY_CACHE_MSC_READ]  = "msc_read",
+};
+
+BUILD_ASSERT(ARRAY_SIZE(cache_region_names) == __TELEMETRY_CACHE_MAX);
+
+// Hits in per mille of all lookups
+static uint32_t hit_permille(uint64_t hits, uint64_t misses)
+{
+	uint64_t lookups = hits + misses;
+
+	return lookups ? (uint32_t)(hits * 1000 / lookups) : 0;
+}
+
+// The misses of an average run, which stay in 32 bits unlike the totals
+static uint32_t per_run(uint64_t count, uint32_t runs)
+{
+	return runs ? (uint32_t)(count / runs) : 0;
+}
+
+static const struct {
+	const char *name;
+	const struct zbus_channel *chan;
+} bus_channels[] = {
+	{ "touch",   &bus_touch_chan },
+	{ "pad_raw", &bus_pad_raw_chan },
+	{ "conn",    &bus_conn_chan },
+	{ "ui",      &bus_ui_chan },
+	{ "tune",    &bus_tune_chan },
+};
+
+telemetry_t telemetry;
+
+K_MUTEX_DEFINE(telemetry_table_lock);
+
+size_t telemetry_format_text(char *buf, size_t size)
+{
+	static uint32_t prev_scans, prev_stream_bytes, prev_usb_link_bytes, prev_uptime;
+	uint32_t uptime = k_uptime_get_32();
+	uint32_t scans = telemetry.scans;
+	uint32_t stream_bytes = telemetry.stream_bytes;
+	uint32_t usb_link_bytes = telemetry.usb_link_bytes;
+	uint32_t elapsed = uptime - prev_uptime;
+	size_t len = 0;
+	int i;
+
+#define APPEND(...) \
+	len += snprintf(&buf[len], (len < size) ? size - len : 0, __VA_ARGS__)
+
+	APPEND("uptime_ms          %u\r\n", uptime);
+	APPEND("scans              %u per_sec %u\r\n", scans,
+	       elapsed ? (uint32_t)((uint64_t)(scans - prev_scans) * 1000 / elapsed) : 0);
+
+	prev_scans = scans;
+
+	for (i = 0; i < MIN(telemetry.pad_count, TELEMETRY_MAX_PADS); ++i) {
+		const telemetry_pad_t *pad = &telemetry.pads[i];
+
+		APPEND("pad%d               baseline %u noise %u.%02u timeouts %u\r\n", i,
+		       pad->baseline,
+		       pad->noise >> TELEMETRY_NOISE_SHIFT,
+		       ((pad->noise & BIT_MASK(TELEMETRY_NOISE_SHIFT)) * 100) >> TELEMETRY_NOISE_SHIFT,
+		       pad->timeouts);
+	}
+
+	APPEND("reports            sent %u coalesced %u dropped %u\r\n",
+	       telemetry.reports_sent, telemetry.reports_coalesced, telemetry.reports_dropped);
+	APPEND("reconnects         %u last_ms %u max_ms %u\r\n",
+	       telemetry.reconnects, telemetry.reconnect_last_ms, telemetry.reconnect_max_ms);
+	APPEND("press_report_us    last %u max %u\r\n", telemetry.press_report_last_us, telemetry.press_report_max_us);
+	APPEND("press_notify_us    last %u max %u\r\n", telemetry.press_notify_last_us, telemetry.press_notify_max_us);
+	APPEND("conn_interval_us   %u\r\n", telemetry.conn_interval_us);
+	APPEND("led_edges          %u\r\n", telemetry.led_edges);
+	APPEND("slide              steps %u swipes %u report_last_us %u report_max_us %u\r\n",
+	       telemetry.slide_steps, telemetry.swipes,
+	       telemetry.slide_report_last_us, telemetry.slide_report_max_us);
+	APPEND("stream             frames %u dropped %u notifications %u bytes_per_sec %u\r\n",
+	       telemetry.stream_frames, telemetry.stream_frames_dropped, telemetry.stream_notifications,
+	       elapsed ? (uint32_t)((uint64_t)(stream_bytes - prev_stream_bytes) * 1000 / elapsed) : 0);
+	APPEND("usb_link           frames %u dropped %u rx_dropped %u backlog_max %u bytes_per_sec %u\r\n",
+	       telemetry.usb_link_frames, telemetry.usb_link_dropped, telemetry.usb_link_rx_dropped,
+	       telemetry.usb_link_backlog_max,
+	       elapsed ? (uint32_t)((uint64_t)(usb_link_bytes - prev_usb_link_bytes) * 1000 / elapsed) : 0);
+
+	if (IS_ENABLED(CONFIG_APP_CLOCK_GOV)) {
+		APPEND("clock              boosts %u 128m_ms %u 64m_ms %u\r\n",
+		       telemetry.clock_boosts, telemetry.clock_boosted_ms, telemetry.clock_base_ms);
+	}
+
+	if (IS_ENABLED(CONFIG_APP_ENERGY)) {
+		// Brought up to date here, the scan only switches consumers on and off
+		energy_publish();
+
+		APPEND("energy_nah        ");
+
+		for (i = 0; i < __TELEMETRY_ENERGY_MAX; ++i) {
+			APPEND(" %s %u", energy_consumer_names[i], telemetry.energy_nah[i]);
+		}
+
+		APPEND(" total %u\r\n", telemetry.energy_total_nah);
+		APPEND("energy             average_ua %u battery_life_h %u\r\n",
+		       telemetry.energy_average_ua, telemetry.energy_life_h);
+	}
+
+	APPEND("sleeps             %u\r\n", telemetry.sleeps);
+	APPEND("wake_report_ms     last %u max %u\r\n", telemetry.wake_report_last_ms, telemetry.wake_report_max_ms);
+
+	prev_stream_bytes = stream_bytes;
+	prev_usb_link_bytes = usb_link_bytes;
+	prev_uptime = uptime;
+
+	for (i = 0; i < ARRAY_SIZE(bus_channels); ++i) {
+		const bus_stats_t *stats = bus_stats(bus_channels[i].chan);
+
+		APPEND("bus_%-15s publishes %u drops %u latency_us %u max %u\r\n", bus_channels[i].name,
+		       (uint32_t)atomic_get(&stats->publishes),
+		       (uint32_t)atomic_get(&stats->drops),
+		       stats->latency_last_us,
+		       stats->latency_max_us);
+	}
+
+	k_mutex_lock(&telemetry_table_lock, K_FOREVER);
+
+	for (i = 0; i < MIN(telemetry.thread_count, TELEMETRY_MAX_THREADS); ++i) {
+		const telemetry_thread_t *thread = &telemetry.threads[i];
+
+		APPEND("thread_%-12.12s cpu %u.%u%% stack %u/%u\r\n", thread->name,
+		       thread->cpu_permille / 10, thread->cpu_permille % 10,
+		       thread->stack_used, thread->stack_size);
+	}
+
+	for (i = 0; i < MIN(telemetry.queue_count, TELEMETRY_MAX_QUEUES); ++i) {
+		const telemetry_queue_t *queue = &telemetry.queues[i];
+
+		APPEND("queue_%-13.12s used %u max %u size %u\r\n", queue->name,
+		       queue->used, queue->used_max, queue->size);
+	}
+
+	k_mutex_unlock(&telemetry_table_lock);
+
+	if (IS_ENABLED(CONFIG_APP_HEALTH)) {
+		APPEND("isr                sample_ready %u timer_overrun %u\r\n",
+		       telemetry.isr_sample_ready, telemetry.isr_timer_overrun);
+		APPEND("health_sample_us   %u\r\n", telemetry.health_sample_us);
+	}
+
+	if (IS_ENABLED(CONFIG_APP_HEALTH_ISR_TIMING)) {
+		const telemetry_isr_time_t *ready = &telemetry.isr_sample_ready_time;
+		const telemetry_isr_time_t *overrun = &telemetry.isr_timer_overrun_time;
+
+		APPEND("isr_sample_ready_cycles last %u min %u max %u jitter %u\r\n",
+		       ready->last, ready->min, ready->max, ready->max - ready->min);
+		APPEND("isr_timer_overrun_cycles last %u min %u max %u jitter %u\r\n",
+		       overrun->last, overrun->min, overrun->max, overrun->max - overrun->min);
+	}
+
+	for (i = 0; IS_ENABLED(CONFIG_APP_CACHE_PROF) && i < __TELEMETRY_CACHE_MAX; ++i) {
+		const telemetry_cache_t *cache = &telemetry.cache[i];
+		uint32_t instruction = hit_permille(cache->instruction_hits, cache->instruction_misses);
+		uint32_t data = hit_permille(cache->data_hits, cache->data_misses);
+
+		APPEND("cache_%-13s runs %u ihit %u.%u%% imiss/run %u dhit %u.%u%% dmiss/run %u\r\n",
+		       cache_region_names[i], cache->runs,
+		       instruction / 10, instruction % 10, per_run(cache->instruction_misses, cache->runs),
+		       data / 10, data % 10, per_run(cache->data_misses, cache->runs));
+	}
+
+	APPEND("boot_ms           ");
+
+	for (i = 0; i < __TELEMETRY_BOOT_MAX; ++i) {
+		APPEND(" %s %u", boot_phase_names[i], telemetry.boot_phase_ms[i]);
+	}
+
+	APPEND("\r\n");
+
+#undef APPEND
+
+	len = MIN(len, size);
+
+	memset(&buf[len], ' ', size - len);
+
+	return len;
+}
+
+size_t telemetry_format_bin(uint8_t *buf, size_t size)
+{
+	telemetry_bin_header_t header = {
+		.magic = sys_cpu_to_le32(TELEMETRY_BIN_MAGIC),
+		.version = sys_cpu_to_le16(TELEMETRY_BIN_VERSION),
+		.length = sys_cpu_to_le16(sizeof(telemetry_t)),
+		.uptime_ms = sys_cpu_to_le32(k_uptime_get_32()),
+	};
+	size_t len = 0;
+
+	memset(buf, 0, size);
+
+	if (size < sizeof(header) + sizeof(telemetry)) {
+		return 0;
+	}
+
+	memcpy(&buf[len], &header, sizeof(header));
+	len += sizeof(header);
+
+	energy_publish();
+
+	k_mutex_lock(&telemetry_table_lock, K_FOREVER);
+	memcpy(&buf[len], &telemetry, sizeof(telemetry));
+	k_mutex_unlock(&telemetry_table_lock);
+	len += sizeof(telemetry);
+
+	return len;
+}
+
+static void pad_raw_listener(const struct zbus_channel *chan)
+{
+	const bus_pad_raw_msg_t *raw = zbus_chan_const_msg(chan);
+	telemetry_pad_t *data;
+	uint32_t deviation;
+
+	if (raw->pad >= TELEMETRY_MAX_PADS) {
+		return;
+	}
+
+	data = &telemetry.pads[raw->pad];
+	deviation = (raw->value > data->baseline) ? raw->value - data->baseline : data->baseline - raw->value;
+
+	// Exponential moving average with a weight of 1/16
+	data->noise += (int32_t)((deviation << TELEMETRY_NOISE_SHIFT) - data->noise) >> TELEMETRY_NOISE_SHIFT;
+}
+
+static void conn_listener(const struct zbus_channel *chan)
+{
+	const bus_conn_msg_t *conn = zbus_chan_const_msg(chan);
+	uint32_t latency;
+
+	if (!conn->connected) {
+		telemetry.disconnected_at_ms = k_uptime_get_32();
+		return;
+	}
+
+	if (!telemetry.disconnected_at_ms) {
+		return;
+	}
+
+	latency = k_uptime_get_32() - telemetry.disconnected_at_ms;
+
+	telemetry.disconnected_at_ms = 0;
+	telemetry.reconnect_last_ms = latency;
+	++telemetry.reconnects;
+
+	if (latency > telemetry.reconnect_max_ms) {
+		telemetry.reconnect_max_ms = latency;
+	}
+}
+
+ZBUS_LISTENER_DEFINE(telemetry_pad_raw_lis, pad_raw_listener);
+ZBUS_CHAN_ADD_OBS(bus_pad_raw_chan, telemetry_pad_raw_lis, 0);
+
+ZBUS_LISTENER_DEFINE(telemetry_conn_lis, conn_listener);
+ZBUS_CHAN_ADD_OBS(bus_conn_chan, telemetry_conn_lis, 1);
@@ -0,0 +1,200 @@
+/**
+ * @file    telemetry.h
+ * @author  Matthijs Bakker
+ * @date    2026-10-18
+ * @brief   Live runtime counters
+ *
+ * Producers only bump plain counters, formatting is done by the reader.
+ * With CONFIG_APP_TELEMETRY disabled, all update macros compile to nothing.
+ */
+
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <zephyr/kernel.h>
+
+#define TELEMETRY_MAX_PADS          8
+#define TELEMETRY_NOISE_SHIFT       4
+#define TELEMETRY_MAX_THREADS       16
+#define TELEMETRY_MAX_QUEUES        4
+#define TELEMETRY_NAME_LEN          12
+
+typedef enum {
+	TELEMETRY_BOOT_USBMS,
+	TELEMETRY_BOOT_BLE,
+	TELEMETRY_BOOT_SENSE,
+	TELEMETRY_BOOT_CALIBRATED,
+
+	__TELEMETRY_BOOT_MAX,
+} telemetry_boot_phase_t;
+
+typedef enum {
+	TELEMETRY_ENERGY_SCAN,          // CPU and constant latency during a scan
+	TELEMETRY_ENERGY_SENSE,         // COMP and TIMER1 while a pad is measured
+	TELEMETRY_ENERGY_LED,
+	TELEMETRY_ENERGY_ADVERTISING,
+	TELEMETRY_ENERGY_CONNECTION,
+
+	__TELEMETRY_ENERGY_MAX,
+} telemetry_energy_consumer_t;
+
+typedef enum {
+	TELEMETRY_CACHE_SCAN,
+	TELEMETRY_CACHE_DETECT,
+	TELEMETRY_CACHE_HID_SEND,
+	TELEMETRY_CACHE_MSC_READ,
+
+	__TELEMETRY_CACHE_MAX,
+} telemetry_cache_region_t;
+
+typedef struct {
+	uint32_t baseline;
+	uint32_t noise;             // mean absolute deviation from baseline, Q4
+	uint32_t timeouts;
+} telemetry_pad_t;
+
+typedef struct {
+	char name[TELEMETRY_NAME_LEN];
+	uint16_t cpu_permille;      // share of the last sampling interval
+	uint16_t stack_size;
+	uint16_t stack_used;        // high-water mark
+} telemetry_thread_t;
+
+// 64-bit, the scan alone wraps 32-bit hit counts within hours
+typedef struct {
+	uint64_t instruction_hits;
+	uint64_t instruction_misses;
+	uint64_t data_hits;
+	uint64_t data_misses;
+	uint32_t runs;
+} telemetry_cache_t;
+
+typedef struct {
+	uint32_t last;              // CPU cycles from entry to exit
+	uint32_t min;
+	uint32_t max;
+} telemetry_isr_time_t;
+
+typedef struct {
+	char name[TELEMETRY_NAME_LEN];
+	uint16_t used;
+	uint16_t used_max;
+	uint16_t size;
+} telemetry_queue_t;
+
+typedef struct {
+	uint32_t scans;
+	uint32_t pad_count;
+	telemetry_pad_t pads[TELEMETRY_MAX_PADS];
+
+	uint32_t reports_sent;
+	uint32_t reports_coalesced;
+	uint32_t reports_dropped;
+
+	uint32_t disconnected_at_ms;
+	uint32_t reconnects;
+	uint32_t reconnect_last_ms;
+	uint32_t reconnect_max_ms;
+
+	uint32_t press_report_last_us;  // state change accepted to report queued
+	uint32_t press_report_max_us;
+	uint32_t press_notify_last_us;  // state change accepted to report sent to the central
+	uint32_t press_notify_max_us;
+	uint32_t conn_interval_us;      // of the most recent connection or update
+
+	uint32_t led_edges;
+
+	uint32_t slide_steps;
+	uint32_t swipes;
+	uint32_t slide_report_last_us;  // end of slide or step to report
+	uint32_t slide_report_max_us;
+
+	uint32_t stream_frames;
+	uint32_t stream_frames_dropped;
+	uint32_t stream_notifications;
+	uint32_t stream_bytes;
+
+	uint32_t usb_link_frames;
+	uint32_t usb_link_dropped;
+	uint32_t usb_link_bytes;
+	uint32_t usb_link_backlog_max;  // bytes waiting in the TX ring
+	uint32_t usb_link_rx_dropped;   // command bytes which did not fit the RX ring
+
+	uint32_t clock_boosts;
+	uint32_t clock_boosted_ms;      // at 128 MHz
+	uint32_t clock_base_ms;         // at 64 MHz, since the governor started
+
+	uint32_t energy_nah[__TELEMETRY_ENERGY_MAX];
+	uint32_t energy_total_nah;      // including the baseline current
+	uint32_t energy_average_ua;
+	uint32_t energy_life_h;         // projected on a full battery
+
+	uint32_t sleeps;
+	uint32_t wake_report_last_ms;
+	uint32_t wake_report_max_ms;
+
+	uint32_t thread_count;
+	telemetry_thread_t threads[TELEMETRY_MAX_THREADS];
+	uint32_t queue_count;
+	telemetry_queue_t queues[TELEMETRY_MAX_QUEUES];
+	uint32_t isr_sample_ready;
+	uint32_t isr_timer_overrun;
+	telemetry_isr_time_t isr_sample_ready_time;
+	telemetry_isr_time_t isr_timer_overrun_time;
+	uint32_t health_sample_us;      // cost of the last sampling pass
+
+	telemetry_cache_t cache[__TELEMETRY_CACHE_MAX];
+
+	uint32_t boot_phase_ms[__TELEMETRY_BOOT_MAX];
+} telemetry_t;
+
+#if CONFIG_APP_TELEMETRY
+
+extern telemetry_t telemetry;
+
+// Held while the thread and queue tables are rewritten or read
+extern struct k_mutex telemetry_table_lock;
+
+#define TELEMETRY_INC(field)            ((void)++telemetry.field)
+#define TELEMETRY_SET(field, value)     ((void)(telemetry.field = (value)))
+#define TELEMETRY_ADD(field, value)     ((void)(telemetry.field += (value)))
+#define TELEMETRY_MAX(field, value)     ((void)(telemetry.field = MAX(telemetry.field, (value))))
+#define TELEMETRY_BOOT_PHASE(phase)     TELEMETRY_SET(boot_phase_ms[phase], k_uptime_get_32())
+
+#else
+
+#define TELEMETRY_INC(field)            ((void)0)
+#define TELEMETRY_SET(field, value)     ((void)0)
+#define TELEMETRY_ADD(field, value)     ((void)0)
+#define TELEMETRY_MAX(field, value)     ((void)0)
+#define TELEMETRY_BOOT_PHASE(phase)     ((void)0)
+
+#endif
+
+/**
+ * Render the counters as human readable text.
+ *
+ * The buffer is always filled up to size, unused space is padded with
+ * spaces so that the result can back a fixed size file.
+ *
+ * @param buf   destination buffer
+ * @param size  size of the destination buffer
+ *
+ * @returns number of bytes of actual content
+ */
+size_t telemetry_format_text(char *buf, size_t size);
+
+/**
+ * Render the counters as a binary snapshot (header + telemetry_t).
+ *
+ * @param buf   destination buffer, zero padded up to size
+ * @param size  size of the destination buffer
+ *
+ * @returns number of bytes of actual content
+ */
+size_t telemetry_format_bin(uint8_t *buf, size_t size);
+
+#endif /* TELEMETRY_H_ */
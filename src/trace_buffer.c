@@ -0,0 +1,88 @@
+/**
+ * @file    trace_buffer.c
+ * @author  Matthijs Bakker
+ * @date    2026-10-18
+ * @brief   RAM buffer of the CTF trace
+ *
+ * A minimal UART driver whose only output is the buffer. With synchronous
+ * tracing, the tracing core writes every event as a whole while holding a
+ * spinlock. A restart from a thread therefore always falls between two
+ * events, and the new capture starts with a complete event.
+ */
+
+#define DT_DRV_COMPAT mb_trace_buffer
+
+#include "trace_buffer.h"
+
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/uart.h>
+
+BUILD_ASSERT(DT_NODE_HAS_COMPAT(DT_CHOSEN(zephyr_tracing_uart), mb_trace_buffer),
+	     "zephyr,tracing-uart must be the trace buffer, see overlay-tracing.overlay");
+
+static uint8_t buffer[TRACE_BUFFER_SIZE];
+static size_t used;
+static struct k_spinlock buffer_lock;
+
+static void trace_buffer_poll_out(const struct device *dev, unsigned char byte)
+{
+	k_spinlock_key_t key = k_spin_lock(&buffer_lock);
+
+	ARG_UNUSED(dev);
+
+	// A full buffer keeps the start of the capture
+	if (used < sizeof(buffer)) {
+		buffer[used++] = byte;
+	}
+
+	k_spin_unlock(&buffer_lock, key);
+}
+
+static int trace_buffer_poll_in(const struct device *dev, unsigned char *byte)
+{
+	ARG_UNUSED(dev);
+	ARG_UNUSED(byte);
+
+	return -1;
+}
+
+static const struct uart_driver_api trace_buffer_api = {
+	.poll_in = trace_buffer_poll_in,
+	.poll_out = trace_buffer_poll_out,
+};
+
+void trace_buffer_restart(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&buffer_lock);
+
+	used = 0;
+
+	k_spin_unlock(&buffer_lock, key);
+}
+
+size_t trace_buffer_used(void)
+{
+	return used;
+}
+
+void trace_buffer_read(uint8_t *buf, size_t offset, size_t size)
+{
+	k_spinlock_key_t key = k_spin_lock(&buffer_lock);
+	size_t end = used;
+	size_t copy = (offset < end) ? MIN(size, end - offset) : 0;
+
+	k_spin_unlock(&buffer_lock, key);
+
+	// Bytes up to end are final, a stale tail of an earlier capture is not copied
+	if (copy) {
+		memcpy(buf, &buffer[offset], copy);
+	}
+
+	memset(&buf[copy], 0, size - copy);
+}
+
+DEVICE_DT_INST_DEFINE(0, NULL, NULL, NULL, NULL, PRE_KERNEL_1, CONFIG_KERNEL_INIT_PRIORITY_DEVICE,
+		      &trace_buffer_api);
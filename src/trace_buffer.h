@@ -0,0 +1,35 @@
+/**
+ * @file    trace_buffer.h
+ * @author  Matthijs Bakker
+ * @date    2026-10-18
+ * @brief   RAM buffer of the CTF trace
+ *
+ * The node chosen as zephyr,tracing-uart is a RAM buffer instead of a
+ * serial port, so the UART tracing backend writes the CTF stream of a
+ * tracing build to memory owned by the application. A capture runs from
+ * boot until the buffer is full, trace_buffer_restart() starts a new one.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <zephyr/devicetree.h>
+
+#define TRACE_BUFFER_SIZE           DT_PROP(DT_CHOSEN(zephyr_tracing_uart), size)
+
+/**
+ * Drop the current capture and start filling the buffer from the start.
+ * Must be called from a thread.
+ */
+void trace_buffer_restart(void);
+
+/**
+ * Bytes captured so far.
+ */
+size_t trace_buffer_used(void);
+
+/**
+ * Copy a part of the capture, which reads as zeros beyond its end and
+ * beyond the end of the buffer.
+ */
+void trace_buffer_read(uint8_t *buf, size_t offset, size_t size);
@@ -0,0 +1,141 @@
+/**
+ * @file    nrfx.h
+ * @author  Matthijs Bakker
+ * @date    2026-10-18
+ * @brief   Register models of the sensing peripherals for native_sim
+ *
+ * Stands in for the real nrfx.h when building for native_sim, so that
+ * sense.c and main.c compile unmodified. Only the registers and fields the
+ * application touches are modelled. The peripherals are plain structs in
+ * RAM which twin.c evaluates periodically.
+ */
+
+#include <stdint.h>
+
+#define COMP_LPCOMP_IRQn                        10
+#define TIMER1_IRQn                             11
+
+typedef struct {
+	volatile uint32_t EN;
+	volatile uint32_t DIS;
+} twin_dppic_chg_t;
+
+typedef struct {
+	volatile uint32_t TASKS_START;
+	volatile uint32_t TASKS_STOP;
+	volatile uint32_t EVENTS_CROSS;
+	volatile uint32_t EVENTS_UP;
+	volatile uint32_t PUBLISH_CROSS;
+	volatile uint32_t PUBLISH_UP;
+	volatile uint32_t PUBLISH_DOWN;
+	volatile uint32_t SUBSCRIBE_STOP;
+	volatile uint32_t INTENSET;
+	volatile uint32_t INTENCLR;
+	volatile uint32_t ENABLE;
+	volatile uint32_t PSEL;
+	volatile uint32_t REFSEL;
+	volatile uint32_t TH;
+	volatile uint32_t MODE;
+	volatile uint32_t ISOURCE;
+	volatile uint32_t ANADETECT;
+	volatile uint32_t HYST;
+} NRF_COMP_Type;
+
+typedef NRF_COMP_Type NRF_LPCOMP_Type;
+
+typedef struct {
+	volatile uint32_t TASKS_STOP;
+	volatile uint32_t TASKS_CLEAR;
+	volatile uint32_t EVENTS_COMPARE[6];
+	volatile uint32_t SUBSCRIBE_START;
+	volatile uint32_t SUBSCRIBE_STOP;
+	volatile uint32_t SUBSCRIBE_CAPTURE[6];
+	volatile uint32_t SHORTS;
+	volatile uint32_t INTENSET;
+	volatile uint32_t BITMODE;
+	volatile uint32_t PRESCALER;
+	volatile uint32_t CC[6];
+} NRF_TIMER_Type;
+
+typedef struct {
+	twin_dppic_chg_t TASKS_CHG[6];
+	twin_dppic_chg_t SUBSCRIBE_CHG[6];
+	volatile uint32_t CHG[6];
+} NRF_DPPIC_Type;
+
+typedef struct {
+	volatile uint32_t TASKS_CONSTLAT;
+	volatile uint32_t TASKS_LOWPWR;
+} NRF_POWER_Type;
+
+extern NRF_COMP_Type twin_comp;
+extern NRF_LPCOMP_Type twin_lpcomp;
+extern NRF_TIMER_Type twin_timer1;
+extern NRF_DPPIC_Type twin_dppic;
+extern NRF_POWER_Type twin_power;
+
+#define NRF_COMP                                (&twin_comp)
+#define NRF_LPCOMP                              (&twin_lpcomp)
+#define NRF_TIMER1                              (&twin_timer1)
+#define NRF_DPPIC                               (&twin_dppic)
+#define NRF_POWER                               (&twin_power)
+
+// Field values follow the nRF5340 product specification
+
+#define COMP_ENABLE_ENABLE_Pos                  0
+#define COMP_ENABLE_ENABLE_Disabled             0
+#define COMP_ENABLE_ENABLE_Enabled              2
+#define COMP_INTEN_CROSS_Msk                    (1UL << 3)
+#define COMP_PSEL_PSEL_Pos                      0
+#define COMP_REFSEL_REFSEL_Pos                  0
+#define COMP_REFSEL_REFSEL_VDD                  4
+#define COMP_TH_THDOWN_Pos                      0
+#define COMP_TH_THUP_Pos                        8
+#define COMP_MODE_SP_Pos                        0
+#define COMP_MODE_SP_High                       2
+#define COMP_MODE_MAIN_Pos                      8
+#define COMP_MODE_MAIN_SE                       0
+#define COMP_ISOURCE_ISOURCE_Pos                0
+#define COMP_ISOURCE_ISOURCE_Ien10mA            3
+#define COMP_PUBLISH_CROSS_CHIDX_Pos            0
+#define COMP_PUBLISH_CROSS_EN_Msk               (1UL << 31)
+#define COMP_PUBLISH_UP_CHIDX_Pos               0
+#define COMP_PUBLISH_UP_EN_Msk                  (1UL << 31)
+#define COMP_PUBLISH_DOWN_CHIDX_Pos             0
+#define COMP_PUBLISH_DOWN_EN_Msk                (1UL << 31)
+#define COMP_SUBSCRIBE_STOP_CHIDX_Pos           0
+#define COMP_SUBSCRIBE_STOP_EN_Msk              (1UL << 31)
+
+#define LPCOMP_ENABLE_ENABLE_Pos                0
+#define LPCOMP_ENABLE_ENABLE_Disabled           0
+#define LPCOMP_ENABLE_ENABLE_Enabled            1
+#define LPCOMP_PSEL_PSEL_Pos                    0
+#define LPCOMP_REFSEL_REFSEL_Pos                0
+#define LPCOMP_REFSEL_REFSEL_Ref4_8Vdd          3
+#define LPCOMP_ANADETECT_ANADETECT_Pos          0
+#define LPCOMP_ANADETECT_ANADETECT_Up           1
+#define LPCOMP_HYST_HYST_Pos                    0
+#define LPCOMP_HYST_HYST_Enabled                1
+#define LPCOMP_INTENSET_UP_Msk                  (1UL << 1)
+#define LPCOMP_INTENCLR_UP_Msk                  (1UL << 1)
+
+#define TIMER_BITMODE_BITMODE_Pos               0
+#define TIMER_BITMODE_BITMODE_16Bit             0
+#define TIMER_INTENSET_COMPARE1_Msk             (1UL << 17)
+#define TIMER_SHORTS_COMPARE1_CLEAR_Msk         (1UL << 1)
+#define TIMER_SHORTS_COMPARE1_STOP_Msk          (1UL << 9)
+#define TIMER_SUBSCRIBE_START_CHIDX_Pos         0
+#define TIMER_SUBSCRIBE_START_EN_Msk            (1UL << 31)
+#define TIMER_SUBSCRIBE_STOP_CHIDX_Pos          0
+#define TIMER_SUBSCRIBE_STOP_EN_Msk             (1UL << 31)
+#define TIMER_SUBSCRIBE_CAPTURE_CHIDX_Pos       0
+#define TIMER_SUBSCRIBE_CAPTURE_EN_Msk          (1UL << 31)
+
+#define DPPIC_CHG_CH0_Pos                       0
+#define DPPIC_CHG_CH0_Included                  1
+#define DPPIC_CHG_CH1_Pos                       1
+#define DPPIC_CHG_CH1_Included                  1
+#define DPPIC_SUBSCRIBE_CHG_EN_CHIDX_Pos        0
+#define DPPIC_SUBSCRIBE_CHG_EN_EN_Msk           (1UL << 31)
+#define DPPIC_SUBSCRIBE_CHG_DIS_CHIDX_Pos       0
+#define DPPIC_SUBSCRIBE_CHG_DIS_EN_Msk          (1UL << 31)
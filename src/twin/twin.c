@@ -0,0 +1,317 @@
+/**
+ * @file    twin.c
+ * @author  Matthijs Bakker
+ * @date    2026-10-18
+ * @brief   Behavioural models of COMP, LPCOMP, TIMER1 and DPPIC for native_sim
+ *
+ * The model thread evaluates the registers every TWIN_STEP of simulated
+ * time, the same way the DPPI wiring made by sense.c reacts on hardware:
+ *
+ * - COMP started while channel group 0 is enabled: the first crossing
+ *   starts TIMER1 and swaps channel group 0 for group 1.
+ * - The second crossing captures the oscillation period into CC[0] and
+ *   stops TIMER1, COMP and channel group 1.
+ * - LPCOMP fires UP once the armed pad is touched.
+ *
+ * Every crossing raises the COMP interrupt, so the real ISR and sense_pin()
+ * run unmodified. The period of each analog input follows a trace file
+ * given with --capsense-trace or CONFIG_APP_TWIN_TRACE, see README.md for
+ * the format.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include <nrfx.h>
+#include <soc.h>
+#include <cmdline.h>
+#include <nsi_host_trampolines.h>
+
+#define TWIN_STEP                   K_USEC(100)
+#define TWIN_INPUTS                 8
+#define TWIN_IDLE_PERIOD            400     // TIMER1 ticks at 16 MHz
+#define TWIN_TOUCH_LEVEL            (TWIN_IDLE_PERIOD * 3 / 2)
+#define TWIN_JITTER                 8
+#define TWIN_MAX_EVENTS             1024
+#define TWIN_MAX_TRACE_SIZE         32768
+
+typedef enum {
+	TWIN_EVENT_PERIOD,          // set the oscillation period of an input
+	TWIN_EVENT_MISS,            // drop the next crossings of an input
+} twin_event_type_t;
+
+typedef struct {
+	uint32_t time_ms;
+	twin_event_type_t type;
+	uint8_t input;
+	uint32_t value;
+} twin_event_t;
+
+typedef enum {
+	COMP_IDLE,
+	COMP_WAIT_FIRST,
+	COMP_WAIT_SECOND,
+} comp_state_t;
+
+NRF_COMP_Type twin_comp;
+NRF_LPCOMP_Type twin_lpcomp;
+NRF_TIMER_Type twin_timer1;
+NRF_DPPIC_Type twin_dppic;
+NRF_POWER_Type twin_power;
+
+#ifdef TWIN_DEFAULT_TRACE
+static char *trace_path = TWIN_DEFAULT_TRACE; // CONFIG_APP_TWIN_TRACE
+#else
+static char *trace_path;
+#endif
+
+static twin_event_t events[TWIN_MAX_EVENTS];
+static size_t event_count;
+static size_t event_next;
+
+static uint32_t periods[TWIN_INPUTS];
+static uint32_t misses[TWIN_INPUTS];
+
+static comp_state_t comp_state;
+static bool group0_enabled;
+static uint32_t jitter_state = 0x2545f491;
+
+LOG_MODULE_REGISTER(twin);
+
+static uint32_t jitter(void)
+{
+	// xorshift32, deterministic so that runs can be compared
+	jitter_state ^= jitter_state << 13;
+	jitter_state ^= jitter_state >> 17;
+	jitter_state ^= jitter_state << 5;
+
+	return jitter_state % (2 * TWIN_JITTER + 1);
+}
+
+static void irq_raise(void)
+{
+	posix_sw_set_pending_IRQ(COMP_LPCOMP_IRQn);
+}
+
+static void trace_apply(uint32_t now_ms)
+{
+	while (event_next < event_count && events[event_next].time_ms <= now_ms) {
+		const twin_event_t *event = &events[event_next++];
+
+		if (event->type == TWIN_EVENT_PERIOD) {
+			periods[event->input] = event->value;
+		} else {
+			LOG_INF("Dropping the next %u crossings of input %u", event->value, event->input);
+			misses[event->input] += event->value;
+		}
+	}
+}
+
+static bool comp_crossing(void)
+{
+	uint32_t input = twin_comp.PSEL & (TWIN_INPUTS - 1);
+
+	if (misses[input]) {
+		--misses[input];
+		return false;
+	}
+
+	twin_comp.EVENTS_CROSS = 1;
+
+	if (twin_comp.INTENSET & COMP_INTEN_CROSS_Msk) {
+		irq_raise();
+	}
+
+	return true;
+}
+
+static void comp_step(void)
+{
+	uint32_t input = twin_comp.PSEL & (TWIN_INPUTS - 1);
+
+	twin_comp.INTENSET &= ~twin_comp.INTENCLR;
+	twin_comp.INTENCLR = 0;
+
+	if (twin_dppic.TASKS_CHG[0].EN) {
+		twin_dppic.TASKS_CHG[0].EN = 0;
+		group0_enabled = true;
+	}
+
+	if (twin_comp.TASKS_STOP) {
+		twin_comp.TASKS_STOP = 0;
+		comp_state = COMP_IDLE;
+	}
+
+	if (twin_comp.TASKS_START) {
+		twin_comp.TASKS_START = 0;
+
+		if (twin_comp.ENABLE == (COMP_ENABLE_ENABLE_Enabled << COMP_ENABLE_ENABLE_Pos) && group0_enabled) {
+			comp_state = COMP_WAIT_FIRST;
+		}
+	}
+
+	switch (comp_state) {
+	case COMP_WAIT_FIRST:
+		if (comp_crossing()) {
+			group0_enabled = false;
+			comp_state = COMP_WAIT_SECOND;
+		} else {
+			comp_state = COMP_IDLE;
+		}
+		break;
+	case COMP_WAIT_SECOND:
+		if (comp_crossing()) {
+			twin_timer1.CC[0] = periods[input] + jitter() - TWIN_JITTER;
+		}
+		comp_state = COMP_IDLE;
+		break;
+	default:
+		break;
+	}
+}
+
+static void lpcomp_step(void)
+{
+	uint32_t input = twin_lpcomp.PSEL & (TWIN_INPUTS - 1);
+
+	twin_lpcomp.INTENSET &= ~twin_lpcomp.INTENCLR;
+	twin_lpcomp.INTENCLR = 0;
+	twin_lpcomp.TASKS_START = 0;
+	twin_lpcomp.TASKS_STOP = 0;
+
+	if (twin_lpcomp.ENABLE != (LPCOMP_ENABLE_ENABLE_Enabled << LPCOMP_ENABLE_ENABLE_Pos)) {
+		return;
+	}
+
+	if (periods[input] > TWIN_TOUCH_LEVEL && (twin_lpcomp.INTENSET & LPCOMP_INTENSET_UP_Msk)) {
+		twin_lpcomp.EVENTS_UP = 1;
+		irq_raise();
+	}
+}
+
+/**
+ * Parse one trace line: "<ms> <input> <period>" or "<ms> miss <input> <count>".
+ *
+ * @returns 0 on success,
+ *          >0 if the line is not an event
+ */
+static int trace_parse_line(char *line, twin_event_t *event)
+{
+	char *cursor = line;
+
+	while (*cursor == ' ' || *cursor == '\t') {
+		++cursor;
+	}
+
+	if (*cursor == '#' || *cursor == '\0') {
+		return 1;
+	}
+
+	event->time_ms = strtoul(cursor, &cursor, 10);
+
+	while (*cursor == ' ' || *cursor == '\t') {
+		++cursor;
+	}
+
+	if (!strncmp(cursor, "miss", 4)) {
+		event->type = TWIN_EVENT_MISS;
+		cursor += 4;
+	} else {
+		event->type = TWIN_EVENT_PERIOD;
+	}
+
+	event->input = strtoul(cursor, &cursor, 10);
+	event->value = strtoul(cursor, &cursor, 10);
+
+	return event->input >= TWIN_INPUTS;
+}
+
+static void trace_load(void)
+{
+	static char buf[TWIN_MAX_TRACE_SIZE + 1];
+	char *line, *next;
+	long len;
+	int fd;
+	int i;
+
+	for (i = 0; i < TWIN_INPUTS; ++i) {
+		periods[i] = TWIN_IDLE_PERIOD;
+	}
+
+	if (!trace_path) {
+		return;
+	}
+
+	fd = nsi_host_open(trace_path, 0); // O_RDONLY
+
+	if (fd < 0) {
+		LOG_ERR("Failed to open trace %s", trace_path);
+		return;
+	}
+
+	len = nsi_host_read(fd, buf, TWIN_MAX_TRACE_SIZE);
+	nsi_host_close(fd);
+
+	if (len < 0) {
+		LOG_ERR("Failed to read trace %s", trace_path);
+		return;
+	}
+
+	buf[len] = '\0';
+
+	// The events must be sorted by time, later lines are applied later
+	for (line = buf; line && event_count < TWIN_MAX_EVENTS; line = next) {
+		next = strchr(line, '\n');
+
+		if (next) {
+			*next++ = '\0';
+		}
+
+		if (!trace_parse_line(line, &events[event_count])) {
+			++event_count;
+		}
+	}
+
+	LOG_INF("Loaded %zu trace events from %s", event_count, trace_path);
+}
+
+static void twin_thread(void)
+{
+	trace_load();
+
+	while (true) {
+		trace_apply(k_uptime_get_32());
+
+		comp_step();
+		lpcomp_step();
+
+		twin_timer1.TASKS_STOP = 0;
+		twin_timer1.TASKS_CLEAR = 0;
+		twin_power.TASKS_CONSTLAT = 0;
+
+		k_sleep(TWIN_STEP);
+	}
+}
+
+K_THREAD_DEFINE(twin_thread_id, 1024, twin_thread, NULL, NULL, NULL, 0, 0, 0);
+
+static void twin_add_options(void)
+{
+	static struct args_struct_t options[] = {
+		{
+			.option = "capsense-trace",
+			.name = "path",
+			.type = 's',
+			.dest = (void *)&trace_path,
+			.descript = "Trace file with the oscillation period of each analog input over time",
+		},
+		ARG_TABLE_ENDMARKER,
+	};
+
+	native_add_command_line_opts(options);
+}
+
+NATIVE_TASK(twin_add_options, PRE_BOOT_1, 10);
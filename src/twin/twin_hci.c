@@ -0,0 +1,42 @@
+/**
+ * @file    twin_hci.c
+ * @author  Matthijs Bakker
+ * @date    2026-10-18
+ * @brief   Bluetooth HCI transport of native_sim without a controller
+ *
+ * The HCI user channel of native_sim exits at boot unless a controller is
+ * given with --bt-dev, which unattended runs do not have. In its place, this
+ * transport fails to open: bt_enable() returns an error, ble_init() logs it
+ * and the touch pipeline runs without Bluetooth. See overlay-twin.overlay.
+ */
+
+#define DT_DRV_COMPAT mb_twin_hci
+
+#include <errno.h>
+
+#include <zephyr/device.h>
+#include <zephyr/drivers/bluetooth.h>
+
+static int twin_hci_open(const struct device *dev, bt_hci_recv_t recv)
+{
+	ARG_UNUSED(dev);
+	ARG_UNUSED(recv);
+
+	return -ENODEV;
+}
+
+// Never called, the host does not send on a transport which failed to open
+static int twin_hci_send(const struct device *dev, struct net_buf *buf)
+{
+	ARG_UNUSED(dev);
+	ARG_UNUSED(buf);
+
+	return -ENODEV;
+}
+
+static const struct bt_hci_driver_api twin_hci_api = {
+	.open = twin_hci_open,
+	.send = twin_hci_send,
+};
+
+DEVICE_DT_INST_DEFINE(0, NULL, NULL, NULL, NULL, POST_KERNEL, CONFIG_KERNEL_INIT_PRIORITY_DEVICE, &twin_hci_api);
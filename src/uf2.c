@@ -0,0 +1,452 @@
+/**
+ * @file    uf2.c
+ * @author  Matthijs Bakker
+ * @date    2026-10-18
+ * @brief   Drag-and-drop firmware update disk
+ *
+ * Nothing is stored on this disk. Reads are answered from a synthesized FAT12
+ * volume, and every written sector is checked for the UF2 block magic. The
+ * payload of each UF2 block is programmed into image-1 as soon as it arrives,
+ * and an erase page is erased right before the first block that lands in it.
+ * The host does not write the blocks in a guaranteed order, so both the erased
+ * pages and the received blocks are tracked in bitmaps.
+ *
+ * See https://github.com/microsoft/uf2 for the block format.
+ */
+
+#include "uf2.h"
+
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/storage/disk_access.h>
+#include <zephyr/storage/flash_map.h>
+#include <zephyr/drivers/disk.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/reboot.h>
+
+#if CONFIG_MCUBOOT_IMG_MANAGER
+#include <zephyr/dfu/mcuboot.h>
+#endif
+
+#define UF2_MAGIC_START0            0x0A324655
+#define UF2_MAGIC_START1            0x9E5D5157
+#define UF2_MAGIC_END               0x0AB16F30
+#define UF2_FLAG_NOT_MAIN_FLASH     0x00000001
+#define UF2_FLAG_FAMILY_ID          0x00002000
+#define UF2_MAX_PAYLOAD             476
+
+#define IMAGE_BASE_ADDRESS          (CONFIG_FLASH_BASE_ADDRESS + FIXED_PARTITION_OFFSET(slot0_partition))
+#define IMAGE_SLOT_ID               FIXED_PARTITION_ID(slot1_partition)
+#define IMAGE_SLOT_SIZE             FIXED_PARTITION_SIZE(slot1_partition)
+#define IMAGE_PAGE_SIZE             DT_PROP(DT_CHOSEN(zephyr_flash), erase_block_size)
+#define IMAGE_PAGE_COUNT            (IMAGE_SLOT_SIZE / IMAGE_PAGE_SIZE)
+#define IMAGE_MAX_BLOCKS            (IMAGE_SLOT_SIZE / 256)
+
+// Volume layout, FAT12 with one sector per cluster
+#define SECTOR_SIZE                 512
+#define SECTOR_COUNT                4000
+#define RESERVED_SECTORS            1
+#define FAT_COUNT                   2
+#define FAT_SECTORS                 DIV_ROUND_UP((SECTOR_COUNT + 2) * 3 / 2, SECTOR_SIZE)
+#define ROOT_DIR_ENTRIES            64
+#define ROOT_DIR_SECTORS            (ROOT_DIR_ENTRIES * 32 / SECTOR_SIZE)
+#define FAT_START                   RESERVED_SECTORS
+#define ROOT_DIR_START              (FAT_START + FAT_COUNT * FAT_SECTORS)
+#define DATA_START                  (ROOT_DIR_START + ROOT_DIR_SECTORS)
+#define INFO_FILE_CLUSTER           2
+
+BUILD_ASSERT(SECTOR_COUNT - DATA_START < 4085, "Volume too large for FAT12");
+BUILD_ASSERT(IMAGE_SLOT_SIZE % IMAGE_PAGE_SIZE == 0, "Image slot must be page aligned");
+
+typedef struct __packed {
+	uint32_t magic_start0;
+	uint32_t magic_start1;
+	uint32_t flags;
+	uint32_t target_addr;
+	uint32_t payload_size;
+	uint32_t block_no;
+	uint32_t num_blocks;
+	uint32_t family_id;
+	uint8_t  data[UF2_MAX_PAYLOAD];
+	uint32_t magic_end;
+} uf2_block_t;
+
+BUILD_ASSERT(sizeof(uf2_block_t) == SECTOR_SIZE);
+
+typedef struct __packed {
+	uint8_t  jump[3];
+	char     oem_name[8];
+	uint16_t bytes_per_sector;
+	uint8_t  sectors_per_cluster;
+	uint16_t reserved_sectors;
+	uint8_t  fat_count;
+	uint16_t root_dir_entries;
+	uint16_t sector_count16;
+	uint8_t  media;
+	uint16_t sectors_per_fat;
+	uint16_t sectors_per_track;
+	uint16_t heads;
+	uint32_t hidden_sectors;
+	uint32_t sector_count32;
+	uint8_t  drive_number;
+	uint8_t  reserved;
+	uint8_t  boot_signature;
+	uint32_t serial;
+	char     label[11];
+	char     fs_type[8];
+} fat_boot_sector_t;
+
+typedef struct __packed {
+	char     name[11];
+	uint8_t  attr;
+	uint8_t  reserved;
+	uint8_t  create_time_tenths;
+	uint16_t create_time;
+	uint16_t create_date;
+	uint16_t access_date;
+	uint16_t cluster_hi;
+	uint16_t modify_time;
+	uint16_t modify_date;
+	uint16_t cluster_lo;
+	uint32_t size;
+} fat_dir_entry_t;
+
+static const char info_file[] =
+	"UF2 Bootloader " CONFIG_SAMPLE_USBD_PRODUCT "\r\n"
+	"Model: " CONFIG_SAMPLE_USBD_PRODUCT "\r\n"
+	"Board-ID: " CONFIG_BOARD "\r\n";
+
+static const struct flash_area *image_area;
+
+static struct {
+	uint32_t num_blocks;
+	uint32_t blocks_received;
+	uint32_t pages_erased;
+	uint32_t start_ms;
+	bool complete;
+} update;
+
+static ATOMIC_DEFINE(erased_pages, IMAGE_PAGE_COUNT);
+static ATOMIC_DEFINE(received_blocks, IMAGE_MAX_BLOCKS);
+
+static struct k_work_delayable reboot_work;
+
+K_MUTEX_DEFINE(update_lock);
+
+LOG_MODULE_REGISTER(uf2);
+
+static void reboot_handler(struct k_work *work)
+{
+	ARG_UNUSED(work);
+
+	sys_reboot(SYS_REBOOT_WARM);
+}
+
+static void read_boot_sector(uint8_t *buf)
+{
+	fat_boot_sector_t *bs = (fat_boot_sector_t *)buf;
+
+	memcpy(bs->jump, "\xEB\x3C\x90", sizeof(bs->jump));
+	memcpy(bs->oem_name, "UF2 UF2 ", sizeof(bs->oem_name));
+	bs->bytes_per_sector    = sys_cpu_to_le16(SECTOR_SIZE);
+	bs->sectors_per_cluster = 1;
+	bs->reserved_sectors    = sys_cpu_to_le16(RESERVED_SECTORS);
+	bs->fat_count           = FAT_COUNT;
+	bs->root_dir_entries    = sys_cpu_to_le16(ROOT_DIR_ENTRIES);
+	bs->sector_count16      = sys_cpu_to_le16(SECTOR_COUNT);
+	bs->media               = 0xF8;
+	bs->sectors_per_fat     = sys_cpu_to_le16(FAT_SECTORS);
+	bs->sectors_per_track   = sys_cpu_to_le16(1);
+	bs->heads               = sys_cpu_to_le16(1);
+	bs->drive_number        = 0x80;
+	bs->boot_signature      = 0x29;
+	bs->serial              = sys_cpu_to_le32(0x00420042);
+	memcpy(bs->label, "MBC UPDATE ", sizeof(bs->label));
+	memcpy(bs->fs_type, "FAT12   ", sizeof(bs->fs_type));
+
+	buf[510] = 0x55;
+	buf[511] = 0xAA;
+}
+
+static void fat12_set(uint8_t *fat, uint32_t cluster, uint16_t value)
+{
+	uint8_t *entry = &fat[cluster * 3 / 2];
+
+	if (cluster & 1) {
+		entry[0] = (entry[0] & 0x0F) | ((value & 0x0F) << 4);
+		entry[1] = value >> 4;
+	} else {
+		entry[0] = value & 0xFF;
+		entry[1] = (entry[1] & 0xF0) | ((value >> 8) & 0x0F);
+	}
+}
+
+static void read_root_dir(uint8_t *buf)
+{
+	fat_dir_entry_t *entry = (fat_dir_entry_t *)buf;
+
+	memcpy(entry[0].name, "MBC UPDATE ", sizeof(entry[0].name));
+	entry[0].attr = 0x08; // volume label
+
+	memcpy(entry[1].name, "INFO_UF2TXT", sizeof(entry[1].name));
+	entry[1].attr = 0x01; // read-only
+	entry[1].cluster_lo = sys_cpu_to_le16(INFO_FILE_CLUSTER);
+	entry[1].size = sys_cpu_to_le32(sizeof(info_file) - 1);
+}
+
+static void read_sector(uint8_t *buf, uint32_t sector)
+{
+	memset(buf, 0, SECTOR_SIZE);
+
+	if (sector == 0) {
+		read_boot_sector(buf);
+	} else if (sector >= FAT_START && sector < ROOT_DIR_START) {
+		if ((sector - FAT_START) % FAT_SECTORS == 0) {
+			fat12_set(buf, 0, 0xFF8);
+			fat12_set(buf, 1, 0xFFF);
+			fat12_set(buf, INFO_FILE_CLUSTER, 0xFFF);
+		}
+	} else if (sector == ROOT_DIR_START) {
+		read_root_dir(buf);
+	} else if (sector == DATA_START + INFO_FILE_CLUSTER - 2) {
+		memcpy(buf, info_file, sizeof(info_file) - 1);
+	}
+}
+
+static void update_reset(uint32_t num_blocks)
+{
+	memset(&update, 0, sizeof(update));
+	memset(erased_pages, 0, sizeof(erased_pages));
+	memset(received_blocks, 0, sizeof(received_blocks));
+
+	update.num_blocks = num_blocks;
+	update.start_ms = k_uptime_get_32();
+
+	LOG_INF("Receiving image of %u blocks", num_blocks);
+}
+
+static int image_erase_ahead(off_t offset, size_t length)
+{
+	uint32_t page;
+	int err;
+
+	for (page = offset / IMAGE_PAGE_SIZE; page <= (offset + length - 1) / IMAGE_PAGE_SIZE; ++page) {
+		if (atomic_test_and_set_bit(erased_pages, page)) {
+			continue;
+		}
+
+		err = flash_area_erase(image_area, page * IMAGE_PAGE_SIZE, IMAGE_PAGE_SIZE);
+
+		if (err) {
+			LOG_ERR("Failed to erase page %u, err %d", page, err);
+			atomic_clear_bit(erased_pages, page);
+			return 1;
+		}
+
+		++update.pages_erased;
+	}
+
+	return 0;
+}
+
+static void update_complete(void)
+{
+	uint32_t elapsed = MAX(k_uptime_get_32() - update.start_ms, 1);
+	int err = 0;
+
+	update.complete = true;
+
+	LOG_INF("Image received: %u blocks, %u pages erased in %u ms (%u KB/s)",
+		update.num_blocks, update.pages_erased, elapsed,
+		update.num_blocks * SECTOR_SIZE / elapsed);
+
+#if CONFIG_MCUBOOT_IMG_MANAGER
+	err = boot_request_upgrade(BOOT_UPGRADE_TEST);
+
+	if (err) {
+		LOG_ERR("Failed to request upgrade, err %d", err);
+		return;
+	}
+
+	// Give the host some time to finish writing the directory entry
+	k_work_schedule(&reboot_work, K_MSEC(CONFIG_APP_MSC_UF2_REBOOT_DELAY_MS));
+#else
+	ARG_UNUSED(err);
+	LOG_WRN("No image manager, image left in slot without swap request");
+#endif
+}
+
+static int process_block(const uf2_block_t *block)
+{
+	uint32_t flags      = sys_le32_to_cpu(block->flags);
+	uint32_t address    = sys_le32_to_cpu(block->target_addr);
+	uint32_t length     = sys_le32_to_cpu(block->payload_size);
+	uint32_t block_no   = sys_le32_to_cpu(block->block_no);
+	uint32_t num_blocks = sys_le32_to_cpu(block->num_blocks);
+	off_t offset;
+	int err;
+
+	if (flags & UF2_FLAG_NOT_MAIN_FLASH) {
+		return 0;
+	}
+
+	if (CONFIG_APP_MSC_UF2_FAMILY_ID && (flags & UF2_FLAG_FAMILY_ID) &&
+	    sys_le32_to_cpu(block->family_id) != CONFIG_APP_MSC_UF2_FAMILY_ID) {
+		return 0;
+	}
+
+	if (length > UF2_MAX_PAYLOAD || block_no >= num_blocks || num_blocks > IMAGE_MAX_BLOCKS) {
+		LOG_ERR("Invalid UF2 block %u/%u", block_no, num_blocks);
+		return 1;
+	}
+
+	// Compared as an offset, the end address of a block near the top of the address space wraps
+	if (address < IMAGE_BASE_ADDRESS || address - IMAGE_BASE_ADDRESS > IMAGE_SLOT_SIZE - length) {
+		LOG_ERR("UF2 block %u outside of the image slot (0x%08x)", block_no, address);
+		return 2;
+	}
+
+	// A different block count means that a new image is being copied
+	if (num_blocks != update.num_blocks) {
+		update_reset(num_blocks);
+	}
+
+	// Hosts may rewrite blocks of the finished file, which must not restart the update
+	if (update.complete || atomic_test_bit(received_blocks, block_no)) {
+		return 0;
+	}
+
+	offset = address - IMAGE_BASE_ADDRESS;
+
+	err = image_erase_ahead(offset, length);
+
+	if (err) {
+		return 3;
+	}
+
+	err = flash_area_write(image_area, offset, block->data, length);
+
+	if (err) {
+		LOG_ERR("Failed to write block %u, err %d", block_no, err);
+		return 4;
+	}
+
+	atomic_set_bit(received_blocks, block_no);
+
+	if (++update.blocks_received == update.num_blocks) {
+		update_complete();
+	}
+
+	return 0;
+}
+
+static int disk_uf2_init(struct disk_info *disk)
+{
+	ARG_UNUSED(disk);
+
+	return 0;
+}
+
+static int disk_uf2_status(struct disk_info *disk)
+{
+	ARG_UNUSED(disk);
+
+	return DISK_STATUS_OK;
+}
+
+static int disk_uf2_read(struct disk_info *disk, uint8_t *buf, uint32_t sector, uint32_t count)
+{
+	for (; count; --count, ++sector, buf += SECTOR_SIZE) {
+		read_sector(buf, sector);
+	}
+
+	return 0;
+}
+
+static int disk_uf2_write(struct disk_info *disk, const uint8_t *buf, uint32_t sector, uint32_t count)
+{
+	const uf2_block_t *block;
+	int err = 0;
+
+	k_mutex_lock(&update_lock, K_FOREVER);
+
+	// Directory and FAT updates from the host are ignored, only UF2 blocks matter
+	for (; count; --count, buf += SECTOR_SIZE) {
+		block = (const uf2_block_t *)buf;
+
+		if (sys_le32_to_cpu(block->magic_start0) != UF2_MAGIC_START0 ||
+		    sys_le32_to_cpu(block->magic_start1) != UF2_MAGIC_START1 ||
+		    sys_le32_to_cpu(block->magic_end) != UF2_MAGIC_END) {
+			continue;
+		}
+
+		if (process_block(block)) {
+			err = -EIO;
+			break;
+		}
+	}
+
+	k_mutex_unlock(&update_lock);
+
+	return err;
+}
+
+static int disk_uf2_ioctl(struct disk_info *disk, uint8_t cmd, void *buf)
+{
+	switch (cmd) {
+		case DISK_IOCTL_CTRL_INIT:
+		case DISK_IOCTL_CTRL_DEINIT:
+		case DISK_IOCTL_CTRL_SYNC:
+			return 0;
+		case DISK_IOCTL_GET_SECTOR_COUNT:
+			*(uint32_t *)buf = SECTOR_COUNT;
+			return 0;
+		case DISK_IOCTL_GET_SECTOR_SIZE:
+			*(uint32_t *)buf = SECTOR_SIZE;
+			return 0;
+		case DISK_IOCTL_GET_ERASE_BLOCK_SZ:
+			*(uint32_t *)buf = 1;
+			return 0;
+		default:
+			return -EINVAL;
+	}
+}
+
+static const struct disk_operations disk_uf2_ops = {
+	.init = disk_uf2_init,
+	.status = disk_uf2_status,
+	.read = disk_uf2_read,
+	.write = disk_uf2_write,
+	.ioctl = disk_uf2_ioctl,
+};
+
+static struct disk_info disk_uf2 = {
+	.name = UF2_DISK_NAME,
+	.ops = &disk_uf2_ops,
+};
+
+int uf2_init(void)
+{
+	int err;
+
+	err = flash_area_open(IMAGE_SLOT_ID, &image_area);
+
+	if (err) {
+		LOG_ERR("Failed to open image slot, err %d", err);
+		return 1;
+	}
+
+	k_work_init_delayable(&reboot_work, reboot_handler);
+
+	err = disk_access_register(&disk_uf2);
+
+	if (err) {
+		LOG_ERR("Failed to register UF2 disk, err %d", err);
+		return 2;
+	}
+
+	return 0;
+}
@@ -0,0 +1,22 @@
+/**
+ * @file    uf2.h
+ * @author  Matthijs Bakker
+ * @date    2026-10-18
+ * @brief   Drag-and-drop firmware update disk
+ */
+
+#include <stdint.h>
+
+#define UF2_DISK_NAME               "UF2"
+
+/**
+ * Register the "UF2" disk.
+ *
+ * The disk presents a synthesized FAT12 volume with an INFO_UF2.TXT file.
+ * UF2 blocks copied onto it are streamed straight into the secondary image
+ * slot, and an MCUboot upgrade is requested once all blocks have arrived.
+ *
+ * @returns 0 on success,
+ *          >0 on failure
+ */
+int uf2_init(void);
@@ -0,0 +1,313 @@
+/**
+ * @file    usb_link.c
+ * @author  Matthijs Bakker
+ * @date    2026-10-18
+ * @brief   Scan streaming and live tuning over a second CDC-ACM port
+ *
+ * Frames are queued in a TX ring by the scan and drained by the UART
+ * interrupt, so the scan never waits for the host. A frame which does not
+ * fit the ring as a whole is dropped, which keeps the stream parseable.
+ * Commands are collected by the interrupt and handled on the application
+ * work queue, the same context as the scan they tune.
+ */
+
+#include "usb_link.h"
+#include "app_workq.h"
+#include "bus.h"
+#include "telemetry.h"
+#include "trace_buffer.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/uart.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/ring_buffer.h>
+
+#define LINK_MAX_PADS               8
+#define LINK_MAX_PAYLOAD            128     // the stats reply with five counters of 10 digits
+#define LINK_MAX_LINE               48
+#define LINK_FRAME_OVERHEAD         4       // sync, type, length, checksum
+
+typedef struct {
+	const char *name;
+	bus_tune_param_t param;
+	bool per_pad;
+	uint32_t min;
+	uint32_t max;
+} link_tunable_t;
+
+static const link_tunable_t tunables[] = {
+	{ "threshold",    BUS_TUNE_THRESHOLD,    false, 101, 500 },
+	{ "debounce",     BUS_TUNE_DEBOUNCE,     false, 0,   20 },
+	{ "oversampling", BUS_TUNE_OVERSAMPLING, true,  1,   16 },
+	{ "period",       BUS_TUNE_SCAN_PERIOD,  false, 1,   1000 },
+	{ "interval",     BUS_TUNE_CONN_INTERVAL, false, 6,  400 },
+};
+
+static const struct device *const link_dev = DEVICE_DT_GET(DT_NODELABEL(cdc_acm_uart1));
+
+RING_BUF_DECLARE(tx_ring, CONFIG_APP_USB_LINK_TX_BUF_SIZE);
+RING_BUF_DECLARE(rx_ring, LINK_MAX_LINE * 2);
+
+static struct k_spinlock tx_lock;
+
+static uint16_t frame[2 + LINK_MAX_PADS];
+static uint16_t sequence;
+static uint8_t pad_count;
+static bool streaming;
+
+static void rx_process(struct k_work *work);
+
+static K_WORK_DEFINE(rx_work, rx_process);
+
+LOG_MODULE_REGISTER(usb_link);
+
+/**
+ * @returns 0 on success,
+ *          >0 if the frame did not fit the TX ring
+ */
+static int frame_send(usb_link_frame_t type, const void *payload, size_t len)
+{
+	uint8_t header[3] = { USB_LINK_SYNC, type, len };
+	uint8_t checksum = 0;
+	k_spinlock_key_t key;
+	uint32_t backlog;
+	size_t i;
+
+	for (i = 0; i < len; ++i) {
+		checksum ^= ((const uint8_t *)payload)[i];
+	}
+
+	key = k_spin_lock(&tx_lock);
+
+	if (ring_buf_space_get(&tx_ring) < len + LINK_FRAME_OVERHEAD) {
+		k_spin_unlock(&tx_lock, key);
+		TELEMETRY_INC(usb_link_dropped);
+		return 1;
+	}
+
+	ring_buf_put(&tx_ring, header, sizeof(header));
+	ring_buf_put(&tx_ring, payload, len);
+	ring_buf_put(&tx_ring, &checksum, sizeof(checksum));
+
+	backlog = ring_buf_size_get(&tx_ring);
+
+	k_spin_unlock(&tx_lock, key);
+
+	TELEMETRY_MAX(usb_link_backlog_max, backlog);
+
+	uart_irq_tx_enable(link_dev);
+
+	return 0;
+}
+
+static void reply(const char *fmt, ...)
+{
+	char text[LINK_MAX_PAYLOAD];
+	va_list args;
+	int len;
+
+	va_start(args, fmt);
+	len = vsnprintf(text, sizeof(text), fmt, args);
+	va_end(args);
+
+	frame_send(USB_LINK_FRAME_REPLY, text, MIN(len, sizeof(text) - 1));
+}
+
+static void uart_isr(const struct device *dev, void *user_data)
+{
+	k_spinlock_key_t key;
+	uint8_t *data;
+	uint8_t byte;
+	uint32_t len;
+	int sent;
+
+	ARG_UNUSED(user_data);
+
+	while (uart_irq_update(dev) && uart_irq_is_pending(dev)) {
+		if (uart_irq_rx_ready(dev)) {
+			while (uart_fifo_read(dev, &byte, 1) == 1) {
+				// The line is cut short and will be rejected, the host sent faster than it is handled
+				if (ring_buf_put(&rx_ring, &byte, 1) != 1) {
+					TELEMETRY_INC(usb_link_rx_dropped);
+				}
+
+				if (byte == '\n') {
+					k_work_submit_to_queue(&app_workq, &rx_work);
+				}
+			}
+		}
+
+		if (uart_irq_tx_ready(dev)) {
+			key = k_spin_lock(&tx_lock);
+			len = ring_buf_get_claim(&tx_ring, &data, CONFIG_APP_USB_LINK_TX_BUF_SIZE);
+
+			if (!len) {
+				uart_irq_tx_disable(dev);
+				k_spin_unlock(&tx_lock, key);
+				continue;
+			}
+
+			sent = uart_fifo_fill(dev, data, len);
+			ring_buf_get_finish(&tx_ring, MAX(sent, 0));
+			k_spin_unlock(&tx_lock, key);
+
+			TELEMETRY_ADD(usb_link_bytes, MAX(sent, 0));
+		}
+	}
+}
+
+static void command_tune(const link_tunable_t *tunable, char *args)
+{
+	bus_tune_msg_t msg = {
+		.param = tunable->param,
+	};
+	char *end;
+
+	if (tunable->per_pad) {
+		msg.pad = strtoul(args, &end, 10);
+
+		if (end == args || msg.pad >= pad_count) {
+			reply("error pad");
+			return;
+		}
+
+		args = end;
+	}
+
+	msg.value = strtoul(args, &end, 10);
+
+	if (end == args || msg.value < tunable->min || msg.value > tunable->max) {
+		reply("error %s %u..%u", tunable->name, tunable->min, tunable->max);
+		return;
+	}
+
+	bus_publish(&bus_tune_chan, &msg);
+	reply("ok %s %u", tunable->name, msg.value);
+}
+
+static void command_handle(char *line)
+{
+	char *args = line;
+	size_t i;
+
+	// Split the command name from its arguments
+	while (*args && *args != ' ') {
+		++args;
+	}
+
+	if (*args) {
+		*args++ = '\0';
+	}
+
+	if (!strcmp(line, "stream")) {
+		streaming = !strncmp(args, "on", 2);
+		reply("ok stream %s", streaming ? "on" : "off");
+		return;
+	}
+
+#if CONFIG_APP_TELEMETRY
+	if (!strcmp(line, "stats")) {
+		reply("frames %u dropped %u rx_dropped %u bytes %u backlog_max %u",
+		      telemetry.usb_link_frames, telemetry.usb_link_dropped, telemetry.usb_link_rx_dropped,
+		      telemetry.usb_link_bytes, telemetry.usb_link_backlog_max);
+		return;
+	}
+#endif
+
+#if CONFIG_APP_TRACE_BUFFER
+	if (!strcmp(line, "trace")) {
+		if (!strcmp(args, "restart")) {
+			trace_buffer_restart();
+		}
+
+		reply("trace used %u size %u", (uint32_t)trace_buffer_used(), TRACE_BUFFER_SIZE);
+		return;
+	}
+#endif
+
+	for (i = 0; i < ARRAY_SIZE(tunables); ++i) {
+		if (!strcmp(line, tunables[i].name)) {
+			command_tune(&tunables[i], args);
+			return;
+		}
+	}
+
+	if (*line) {
+		reply("error unknown command");
+	}
+}
+
+static void rx_process(struct k_work *work)
+{
+	static char line[LINK_MAX_LINE];
+	static size_t len;
+	uint8_t byte;
+
+	ARG_UNUSED(work);
+
+	while (ring_buf_get(&rx_ring, &byte, 1) == 1) {
+		if (byte == '\r') {
+			continue;
+		}
+
+		if (byte != '\n') {
+			// Overlong lines are truncated, the command will be rejected
+			if (len < sizeof(line) - 1) {
+				line[len++] = byte;
+			}
+			continue;
+		}
+
+		line[len] = '\0';
+		len = 0;
+
+		command_handle(line);
+	}
+}
+
+static void pad_raw_listener(const struct zbus_channel *chan)
+{
+	const bus_pad_raw_msg_t *raw = zbus_chan_const_msg(chan);
+
+	pad_count = raw->pad_count;
+
+	if (!streaming || raw->pad_count > LINK_MAX_PADS) {
+		return;
+	}
+
+	if (raw->pad == 0) {
+		frame[0] = sys_cpu_to_le16(sequence);
+		frame[1] = sys_cpu_to_le16((uint16_t)k_uptime_get_32());
+	}
+
+	frame[2 + raw->pad] = sys_cpu_to_le16(MIN(raw->value, UINT16_MAX));
+
+	if (raw->pad == raw->pad_count - 1) {
+		++sequence;
+		TELEMETRY_INC(usb_link_frames);
+		frame_send(USB_LINK_FRAME_SCAN, frame, (2 + raw->pad_count) * sizeof(uint16_t));
+	}
+}
+
+ZBUS_LISTENER_DEFINE(usb_link_pad_raw_lis, pad_raw_listener);
+ZBUS_CHAN_ADD_OBS(bus_pad_raw_chan, usb_link_pad_raw_lis, 3);
+
+int usb_link_init(void)
+{
+	if (!device_is_ready(link_dev)) {
+		LOG_ERR("Link port is not ready");
+		return 1;
+	}
+
+	uart_irq_callback_user_data_set(link_dev, uart_isr, NULL);
+	uart_irq_rx_enable(link_dev);
+
+	return 0;
+}
@@ -0,0 +1,50 @@
+/**
+ * @file    usb_link.h
+ * @author  Matthijs Bakker
+ * @date    2026-10-18
+ * @brief   Scan streaming and live tuning over a second CDC-ACM port
+ *
+ * The host sends text commands, one per line. The card answers with
+ * binary frames: USB_LINK_SYNC, type, payload length, payload and the XOR
+ * of all payload bytes. A reply frame carries the text answer to a
+ * command, a scan frame carries the sequence number and the low 16 bits
+ * of the uptime in milliseconds followed by the period of every pad, all
+ * little-endian uint16.
+ *
+ * Commands:
+ *   stream on|off              start or stop the scan frames
+ *   threshold <percent>        touch threshold relative to the baseline
+ *   debounce <scans>           scans a state change must persist
+ *   oversampling <pad> <n>     samples averaged per pad per scan
+ *   period <ms>                time between scans
+ *   interval <units>           connection interval of all centrals, 1.25 ms units
+ *   stats                      link throughput and backpressure counters
+ *   trace [restart]            fill of the trace buffer, restart the capture
+ */
+
+#include <stdint.h>
+
+#include <zephyr/sys/util.h>
+
+#define USB_LINK_SYNC               0xa5
+
+typedef enum {
+	USB_LINK_FRAME_REPLY = 1,
+	USB_LINK_FRAME_SCAN  = 2,
+} usb_link_frame_t;
+
+#if CONFIG_APP_USB_LINK
+
+/**
+ * Start receiving commands on the link port.
+ *
+ * @returns 0 on success,
+ *          >0 on failure
+ */
+int usb_link_init(void);
+
+#else
+
+static inline int usb_link_init(void) { return 0; }
+
+#endif
@@ -7,6 +7,12 @@
 
 #include "usbms.h"
 #include "sample_usbd.h"
+#include "flash_cache.h"
+#include "stats_disk.h"
+#include "uf2.h"
+#include "power.h"
+#include "recorder.h"
+#include "trace_buffer.h"
 
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
@@ -17,7 +23,7 @@
 
 LOG_MODULE_REGISTER(usbms);
 
-#if CONFIG_DISK_DRIVER_FLASH
+#if CONFIG_DISK_DRIVER_FLASH || CONFIG_APP_FLASH_DISK_CACHE
 #include <zephyr/storage/flash_map.h>
 #endif
 
@@ -31,6 +37,7 @@ FS_LITTLEFS_DECLARE_DEFAULT_CONFIG(storage);
 #endif
 
 #if !defined(CONFIG_DISK_DRIVER_FLASH) && \
+	!defined(CONFIG_APP_FLASH_DISK_CACHE) && \
 	!defined(CONFIG_DISK_DRIVER_RAM) && \
 	!defined(CONFIG_DISK_DRIVER_SDMMC)
 #error No supported disk driver enabled
@@ -41,13 +48,24 @@ FS_LITTLEFS_DECLARE_DEFAULT_CONFIG(storage);
 
 static struct fs_mount_t fs_mnt;
 
+#if CONFIG_FAT_FILESYSTEM_ELM
+static FATFS fat_fs;
+#endif
+
 static struct usbd_context *sample_usbd;
 
+/* With the stats files enabled, the host reads the RAM disk through the stats overlay */
+#if CONFIG_APP_STATS_FILE
+#define RAM_LUN_DISK_NAME		STATS_DISK_NAME
+#else
+#define RAM_LUN_DISK_NAME		"RAM"
+#endif
+
 #if CONFIG_DISK_DRIVER_RAM
-USBD_DEFINE_MSC_LUN(ram, "RAM", "Zephyr", "RAMDisk", "0.00");
+USBD_DEFINE_MSC_LUN(ram, RAM_LUN_DISK_NAME, "Zephyr", "RAMDisk", "0.00");
 #endif
 
-#if CONFIG_DISK_DRIVER_FLASH
+#if CONFIG_DISK_DRIVER_FLASH || CONFIG_APP_FLASH_DISK_CACHE
 USBD_DEFINE_MSC_LUN(nand, "NAND", "Zephyr", "FlashDisk", "0.00");
 #endif
 
@@ -55,6 +73,10 @@ USBD_DEFINE_MSC_LUN(nand, "NAND", "Zephyr", "FlashDisk", "0.00");
 USBD_DEFINE_MSC_LUN(sd, "SD", "Zephyr", "SD", "0.00");
 #endif
 
+#if CONFIG_APP_MSC_UF2_UPDATE
+USBD_DEFINE_MSC_LUN(uf2, UF2_DISK_NAME, "Zephyr", "Update", "0.00");
+#endif
+
 static const unsigned char linkedin_shortcut_file[] = {
 	#include "LinkedIn.url.inc"
 };
@@ -104,11 +126,11 @@ static int mount_app_fs(struct fs_mount_t *mnt)
 	int rc;
 
 #if CONFIG_FAT_FILESYSTEM_ELM
-	static FATFS fat_fs;
-
 	mnt->type = FS_FATFS;
 	mnt->fs_data = &fat_fs;
-	if (IS_ENABLED(CONFIG_DISK_DRIVER_RAM)) {
+	if (IS_ENABLED(CONFIG_APP_FLASH_DISK_CACHE)) {
+		mnt->mnt_point = "/NAND:";
+	} else if (IS_ENABLED(CONFIG_DISK_DRIVER_RAM)) {
 		mnt->mnt_point = "/RAM:";
 	} else if (IS_ENABLED(CONFIG_DISK_DRIVER_SDMMC)) {
 		mnt->mnt_point = "/SD:";
@@ -135,6 +157,14 @@ static int setup_disk(void)
 
 	fs_dir_t_init(&dir);
 
+	if (IS_ENABLED(CONFIG_APP_FLASH_DISK_CACHE)) {
+		rc = flash_cache_init();
+		if (rc) {
+			LOG_ERR("Failed to setup flash disk cache");
+			return 1;
+		}
+	}
+
 	if (IS_ENABLED(CONFIG_DISK_DRIVER_FLASH)) {
 		rc = setup_flash(mp);
 		if (rc < 0) {
@@ -212,7 +242,7 @@ static int create_file(const char *filename, const char *contents, size_t length
 
 	LOG_INF("Making files");
 
-	snprintf(path, sizeof(path), "/RAM:/%s", filename);
+	snprintf(path, sizeof(path), "%s/%s", fs_mnt.mnt_point, filename);
 
 	err = fs_open(&file, path, (FS_O_CREATE | FS_O_WRITE));
 
@@ -233,6 +263,49 @@ static int create_file(const char *filename, const char *contents, size_t length
 	return 0;
 }
 
+#if CONFIG_APP_STATS_FILE
+static int create_stats_file(const char *filename, stats_file_t type, size_t length)
+{
+	static const char padding[32] = { [0 ... 31] = ' ' };
+	struct fs_file_t file;
+	char path[128];
+	size_t written;
+	int err;
+
+	fs_file_t_init(&file);
+
+	snprintf(path, sizeof(path), "%s/%s", fs_mnt.mnt_point, filename);
+
+	err = fs_open(&file, path, (FS_O_CREATE | FS_O_WRITE));
+
+	if (err) {
+		LOG_ERR("Failed to create stats file");
+		return 1;
+	}
+
+	for (written = 0; written < length; written += err) {
+		err = fs_write(&file, padding, MIN(sizeof(padding), length - written));
+
+		if (err <= 0) {
+			LOG_ERR("Failed to write file, error %d", err);
+			fs_close(&file);
+			return 2;
+		}
+	}
+
+	fs_close(&file);
+
+	// The volume path as FatFs knows it, without the leading slash
+	f_chmod(&path[1], AM_RDO, AM_RDO);
+
+	if (stats_disk_map(type, filename)) {
+		return 3;
+	}
+
+	return 0;
+}
+#endif
+
 static void create_files()
 {
 	int err;
@@ -260,6 +333,59 @@ static void create_files()
 	if (err) {
 		LOG_ERR("Failed to create README file");
 	}
+
+#if CONFIG_APP_STATS_FILE
+	err = create_stats_file("STATS.TXT", STATS_FILE_TEXT, CONFIG_APP_STATS_FILE_SIZE);
+
+	if (err) {
+		LOG_ERR("Failed to create stats file");
+	}
+
+	if (IS_ENABLED(CONFIG_APP_STATS_FILE_BINARY)) {
+		err = create_stats_file("STATS.BIN", STATS_FILE_BINARY, STATS_DISK_BIN_SIZE);
+
+		if (err) {
+			LOG_ERR("Failed to create binary stats file");
+		}
+	}
+#endif
+
+#if CONFIG_APP_RECORDER
+	err = create_stats_file("RECORD.BIN", STATS_FILE_RECORDING, RECORDER_FILE_SIZE);
+
+	if (err) {
+		LOG_ERR("Failed to create recording file");
+	}
+#endif
+
+#if CONFIG_APP_TRACE_FILE
+	err = create_stats_file("TRACE.CTF", STATS_FILE_TRACE, TRACE_BUFFER_SIZE);
+
+	if (err) {
+		LOG_ERR("Failed to create trace file");
+	}
+#endif
+}
+
+static void usbd_msg_handler(struct usbd_context *const ctx, const struct usbd_msg *const msg)
+{
+	ARG_UNUSED(ctx);
+
+	switch (msg->type) {
+		case USBD_MSG_SUSPEND:
+			if (IS_ENABLED(CONFIG_APP_FLASH_DISK_CACHE)) {
+				flash_cache_flush();
+			}
+			break;
+		case USBD_MSG_VBUS_READY:
+			power_usb_attached(true);
+			break;
+		case USBD_MSG_VBUS_REMOVED:
+			power_usb_attached(false);
+			break;
+		default:
+			break;
+	}
 }
 
 int usbms_init(void)
@@ -273,9 +399,27 @@ int usbms_init(void)
 		return err;
 	}
 
+	// The RAM LUN is bound to the stats disk at build time, it must exist before the files are mapped
+	if (IS_ENABLED(CONFIG_APP_STATS_FILE)) {
+		err = stats_disk_init("RAM");
+
+		if (err) {
+			LOG_ERR("Failed to setup stats disk, err %d, not exposing the drive", err);
+			return err;
+		}
+	}
+
 	create_files();
 
-	sample_usbd = sample_usbd_init_device(NULL);
+	if (IS_ENABLED(CONFIG_APP_MSC_UF2_UPDATE)) {
+		err = uf2_init();
+
+		if (err) {
+			LOG_ERR("Failed to setup update disk, err %d", err);
+		}
+	}
+
+	sample_usbd = sample_usbd_init_device(usbd_msg_handler);
 
 	if (sample_usbd == NULL) {
 		LOG_ERR("Failed to initialize USB device");
@@ -0,0 +1,214 @@
+/**
+ * @file    main.c
+ * @author  Matthijs Bakker
+ * @date    2026-10-18
+ * @brief   Micro-benchmarks of the input pipeline algorithms
+ *
+ * Every benchmark runs its operation CONFIG_BENCH_ITERATIONS times and
+ * prints one CSV line:
+ *
+ *   bench,<name>,<iterations>,<cycles>,<cycles_per_op>,<ns_per_op>
+ *
+ * A benchmark is timed as a whole and divided by the iteration count, so
+ * the loop overhead is included but the cost of reading the counter is not.
+ * scripts/bench_compare.py compares the output of two runs.
+ *
+ * On native_sim and QEMU the cycle counts do not follow the real hardware,
+ * the figures are only meaningful on a board. There the suite still proves
+ * that the benchmarked code builds and behaves.
+ */
+
+#include <zephyr/ztest.h>
+#include <zephyr/timing/timing.h>
+
+#include "detect.h"
+#include "keymap.h"
+#include "slide.h"
+#include "telemetry.h"
+
+#define BENCH_PADS                  4
+#define BENCH_BASELINE              1000
+#define BENCH_TOUCH                 1900    // above the default threshold ratio of 1.7
+#define BENCH_STATS_SIZE            2048
+
+// keymap.c brings settings and Bluetooth along, the inlines only need the table
+static const uint16_t keymap_defaults[__KEYMAP_MODE_MAX][__KEYMAP_SLOT_MAX] = KEYMAP_DEFAULTS;
+uint8_t keymap[__KEYMAP_MODE_MAX][__KEYMAP_SLOT_MAX];
+
+static detect_t detector;
+static slide_t slide;
+static char stats_text[BENCH_STATS_SIZE];
+
+// Results are folded in here, so the compiler cannot drop the work
+static volatile uint32_t sink;
+
+static uint32_t pad_value(uint32_t i, uint8_t pad)
+{
+	// A touch on one pad at a time, moving every 16 scans
+	return ((i >> 4) % BENCH_PADS == pad) ? BENCH_TOUCH : BENCH_BASELINE + (i & 7);
+}
+
+static void bench(const char *name, void (*run)(uint32_t i))
+{
+	const uint32_t iterations = CONFIG_BENCH_ITERATIONS;
+	timing_t start, end;
+	uint64_t cycles, ns;
+	uint32_t i;
+
+	start = timing_counter_get();
+
+	for (i = 0; i < iterations; ++i) {
+		run(i);
+	}
+
+	end = timing_counter_get();
+
+	cycles = timing_cycles_get(&start, &end);
+	ns = timing_cycles_to_ns(cycles);
+
+	TC_PRINT("bench,%s,%u,%u,%u,%u\n", name, iterations, (uint32_t)cycles,
+		 (uint32_t)(cycles / iterations), (uint32_t)(ns / iterations));
+}
+
+static void detect_calibrate_run(uint32_t i)
+{
+	uint8_t pad;
+
+	detect_init(&detector, &(detect_config_t) DETECT_CONFIG_DEFAULT, BENCH_PADS);
+
+	do {
+		for (pad = 0; pad < BENCH_PADS; ++pad) {
+			detect_sample(&detector, pad, BENCH_BASELINE + (i & 7));
+		}
+	} while (!detect_scan_end(&detector));
+
+	sink += detector.pads[0].threshold;
+}
+
+static void detect_scan_run(uint32_t i)
+{
+	uint8_t pad;
+
+	for (pad = 0; pad < BENCH_PADS; ++pad) {
+		sink += detect_sample(&detector, pad, pad_value(i, pad));
+	}
+
+	detect_scan_end(&detector);
+}
+
+static void slide_scan_run(uint32_t i)
+{
+	uint32_t threshold = BENCH_BASELINE * 17 / 10;
+	slide_event_t event;
+	uint8_t pad;
+
+	for (pad = 0; pad < BENCH_PADS; ++pad) {
+		slide_sample(&slide, pad, pad_value(i, pad), threshold);
+	}
+
+	sink += slide_scan_end(&slide, i * 10000, &event);
+}
+
+static void navigation_report_run(uint32_t i)
+{
+	uint8_t keys[6] = {0};
+
+	keymap_navigation_keys(i & BIT_MASK(__KEYMAP_SLOT_MAX), keys, sizeof(keys));
+
+	sink += keys[0] ^ keys[1];
+}
+
+static void media_report_run(uint32_t i)
+{
+	sink += keymap_media_bits(i & BIT_MASK(__KEYMAP_SLOT_MAX));
+}
+
+static void stats_text_run(uint32_t i)
+{
+	ARG_UNUSED(i);
+
+	sink += telemetry_format_text(stats_text, sizeof(stats_text));
+}
+
+static void *setup(void)
+{
+	int mode, slot;
+
+	for (mode = 0; mode < __KEYMAP_MODE_MAX; ++mode) {
+		for (slot = 0; slot < __KEYMAP_SLOT_MAX; ++slot) {
+			zassert_ok(keymap_usage_value(mode, keymap_defaults[mode][slot], &keymap[mode][slot]));
+		}
+	}
+
+	timing_init();
+	timing_start();
+
+	TC_PRINT("bench,name,iterations,cycles,cycles_per_op,ns_per_op\n");
+
+	return NULL;
+}
+
+static void teardown(void *fixture)
+{
+	ARG_UNUSED(fixture);
+
+	timing_stop();
+}
+
+ZTEST(benchmarks, test_detect_calibrate)
+{
+	bench("detect_calibrate", detect_calibrate_run);
+
+	zassert_equal(detector.calibration_remaining, 0);
+	zassert_true(detector.pads[0].threshold > BENCH_BASELINE);
+}
+
+ZTEST(benchmarks, test_detect_scan)
+{
+	detect_calibrate_run(0);
+
+	bench("detect_scan", detect_scan_run);
+
+	// Touches never start a calibration over
+	zassert_equal(detector.calibration_remaining, 0);
+}
+
+ZTEST(benchmarks, test_slide_scan)
+{
+	zassert_ok(slide_init(&slide, BENCH_PADS));
+
+	bench("slide_scan", slide_scan_run);
+}
+
+ZTEST(benchmarks, test_navigation_report)
+{
+	uint8_t keys[6] = {0};
+
+	bench("navigation_report", navigation_report_run);
+
+	keymap_navigation_keys(BIT(KEYMAP_SLOT_KEY1) | BIT(KEYMAP_SLOT_KEY3), keys, sizeof(keys));
+	zassert_equal(keys[0], 0x50);
+	zassert_equal(keys[1], 0x51);
+	zassert_equal(keys[2], 0);
+}
+
+ZTEST(benchmarks, test_media_report)
+{
+	bench("media_report", media_report_run);
+
+	zassert_equal(keymap_media_bits(BIT(KEYMAP_SLOT_KEY0) | BIT(KEYMAP_SLOT_KEY2)), BIT(0) | BIT(2));
+}
+
+ZTEST(benchmarks, test_stats_text)
+{
+	size_t len;
+
+	bench("stats_text", stats_text_run);
+
+	// The whole text fits, the remainder is padded with spaces
+	len = telemetry_format_text(stats_text, sizeof(stats_text));
+	zassert_true(len > 0 && len < sizeof(stats_text), "len %zu", len);
+	zassert_equal(stats_text[sizeof(stats_text) - 1], ' ');
+}
+
+ZTEST_SUITE(benchmarks, NULL, setup, NULL, NULL, teardown);
@@ -0,0 +1,162 @@
+/**
+ * @file    main.c
+ * @author  Matthijs Bakker
+ * @date    2026-10-18
+ * @brief   Tests of the charge estimate
+ *
+ * The kernel clock of native_sim is simulated and only moves while the test
+ * sleeps, so the on-time of every consumer is known to the microsecond and
+ * the published charge is compared exactly.
+ */
+
+#include <zephyr/ztest.h>
+
+#include "telemetry.h"
+#include "energy.h"
+
+#define PC_PER_NAH                  3600000ULL
+
+telemetry_t telemetry;
+
+static uint64_t started_us;
+
+static uint64_t now_us(void)
+{
+	return k_ticks_to_us_floor64(k_uptime_ticks());
+}
+
+// Sleep and return the time slept in us
+static uint64_t run(uint32_t ms)
+{
+	uint64_t start = now_us();
+
+	k_sleep(K_MSEC(ms));
+
+	return now_us() - start;
+}
+
+static uint32_t nah(uint64_t charge_pc)
+{
+	return (uint32_t)(charge_pc / PC_PER_NAH);
+}
+
+static void before(void *fixture)
+{
+	ARG_UNUSED(fixture);
+
+	memset(&telemetry, 0, sizeof(telemetry));
+
+	started_us = now_us();
+	zassert_ok(energy_init());
+}
+
+ZTEST(energy, test_baseline)
+{
+	uint64_t uptime;
+	int i;
+
+	run(1000);
+	energy_publish();
+
+	uptime = now_us() - started_us;
+
+	for (i = 0; i < __TELEMETRY_ENERGY_MAX; ++i) {
+		zassert_equal(telemetry.energy_nah[i], 0, "consumer %d", i);
+	}
+
+	zassert_equal(telemetry.energy_total_nah, nah((uint64_t)CONFIG_APP_ENERGY_SLEEP_UA * uptime));
+	zassert_equal(telemetry.energy_average_ua, CONFIG_APP_ENERGY_SLEEP_UA);
+	zassert_equal(telemetry.energy_life_h, CONFIG_APP_ENERGY_BATTERY_MAH * 1000 / CONFIG_APP_ENERGY_SLEEP_UA);
+}
+
+ZTEST(energy, test_off_only_accumulates)
+{
+	uint64_t on;
+
+	ENERGY_ON(SCAN);
+	on = run(20);
+	ENERGY_OFF(SCAN);
+
+	// Nothing is computed until the telemetry is read
+	zassert_equal(telemetry.energy_nah[TELEMETRY_ENERGY_SCAN], 0);
+	zassert_equal(telemetry.energy_total_nah, 0);
+
+	run(1000);
+	energy_publish();
+
+	// Time after the off does not count
+	zassert_equal(telemetry.energy_nah[TELEMETRY_ENERGY_SCAN], nah((uint64_t)CONFIG_APP_ENERGY_SCAN_UA * on));
+}
+
+ZTEST(energy, test_instances)
+{
+	uint64_t both, one;
+
+	ENERGY_ON(LED);
+	ENERGY_ON(LED);
+	both = run(500);
+	ENERGY_OFF(LED);
+	one = run(250);
+	ENERGY_OFF(LED);
+
+	// Switched off once too often, the count does not go below zero
+	ENERGY_OFF(LED);
+	run(250);
+	energy_publish();
+
+	zassert_equal(telemetry.energy_nah[TELEMETRY_ENERGY_LED],
+		      nah((uint64_t)CONFIG_APP_ENERGY_LED_UA * (2 * both + one)));
+}
+
+ZTEST(energy, test_connection_intervals)
+{
+	uint32_t fast = energy_connection_ua(7500);
+	uint32_t slow = energy_connection_ua(30000);
+	uint32_t updated = energy_connection_ua(15000);
+	uint64_t first, second;
+
+	zassert_equal(fast, CONFIG_APP_ENERGY_RADIO_UA * CONFIG_APP_ENERGY_CONN_EVENT_US / 7500);
+	zassert_equal(slow, fast / 4);
+	zassert_equal(energy_connection_ua(0), 0);
+
+	// Two centrals, each at its own interval
+	ENERGY_CHANGE(CONNECTION, 0, fast);
+	ENERGY_CHANGE(CONNECTION, 0, slow);
+	first = run(1000);
+
+	// The fast one is slowed down, the other is not affected
+	ENERGY_CHANGE(CONNECTION, fast, updated);
+	second = run(1000);
+
+	ENERGY_CHANGE(CONNECTION, updated, 0);
+	ENERGY_CHANGE(CONNECTION, slow, 0);
+	run(1000);
+	energy_publish();
+
+	zassert_equal(telemetry.energy_nah[TELEMETRY_ENERGY_CONNECTION],
+		      nah((uint64_t)(fast + slow) * first + (uint64_t)(updated + slow) * second));
+}
+
+ZTEST(energy, test_total)
+{
+	uint64_t on, uptime, total;
+
+	ENERGY_ON(ADVERTISING);
+	ENERGY_ON(SENSE);
+	on = run(3000);
+	ENERGY_OFF(SENSE);
+	ENERGY_OFF(ADVERTISING);
+	energy_publish();
+
+	uptime = now_us() - started_us;
+	total = (uint64_t)CONFIG_APP_ENERGY_SLEEP_UA * uptime +
+		(uint64_t)CONFIG_APP_ENERGY_SENSE_UA * on +
+		(uint64_t)CONFIG_APP_ENERGY_RADIO_UA * CONFIG_APP_ENERGY_ADV_EVENT_US /
+		(CONFIG_APP_ENERGY_ADV_INTERVAL_MS * 1000) * on;
+
+	zassert_equal(telemetry.energy_total_nah, nah(total));
+	zassert_equal(telemetry.energy_average_ua, total / uptime);
+	zassert_equal(telemetry.energy_life_h, CONFIG_APP_ENERGY_BATTERY_MAH * 1000 / (total / uptime));
+}
+
+ZTEST_SUITE(energy, NULL, NULL, before, NULL, NULL);
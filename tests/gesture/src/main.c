@@ -0,0 +1,214 @@
+/**
+ * @file    main.c
+ * @author  Matthijs Bakker
+ * @date    2026-10-18
+ * @brief   Host unit tests of the gesture engine
+ *
+ * Synthetic key masks and timestamps are fed straight into the engine,
+ * including timestamps around the wrap of the 32-bit millisecond counter
+ * and gaps longer than half of its range.
+ */
+
+#include <zephyr/ztest.h>
+
+#include "gesture.h"
+
+#define KEY_A                       (1 << 0)
+#define KEY_B                       (1 << 1)
+#define KEY_C                       (1 << 2)
+
+enum {
+	ACTION_TAP_A = 1,
+	ACTION_DOUBLE_TAP_B,
+	ACTION_LONG_PRESS_A,
+	ACTION_CHORD_AB,
+	ACTION_CHORD_HOLD_AB,
+	ACTION_LONG_PRESS_C,
+	ACTION_LONGER_PRESS_C,
+};
+
+static const gesture_def_t table[] = {
+	{ GESTURE_TAP,          KEY_A,          0,      ACTION_TAP_A },
+	{ GESTURE_DOUBLE_TAP,   KEY_B,          250,    ACTION_DOUBLE_TAP_B },
+	{ GESTURE_LONG_PRESS,   KEY_A,          600,    ACTION_LONG_PRESS_A },
+	{ GESTURE_CHORD,        KEY_A | KEY_B,  0,      ACTION_CHORD_AB },
+	{ GESTURE_CHORD_HOLD,   KEY_A | KEY_B,  1000,   ACTION_CHORD_HOLD_AB },
+	{ GESTURE_LONG_PRESS,   KEY_C,          1500,   ACTION_LONGER_PRESS_C },
+	{ GESTURE_LONG_PRESS,   KEY_C,          500,    ACTION_LONG_PRESS_C },
+};
+
+static gesture_engine_t engine;
+static int fired[8];
+static int fired_count;
+
+static void recognized(gesture_engine_t *e, const gesture_def_t *gesture)
+{
+	(void) e;
+
+	if (fired_count < (int) ARRAY_SIZE(fired)) {
+		fired[fired_count] = gesture->action;
+	}
+
+	++fired_count;
+}
+
+/**
+ * Run the engine like the work item does: tick at every deadline up to end.
+ */
+static void run_until(uint32_t now, uint32_t end)
+{
+	uint32_t next;
+	int guard = 0;
+
+	for (;;) {
+		next = gesture_tick(&engine, now);
+
+		if (next == GESTURE_NO_DEADLINE || (int32_t)(next - end) > 0) {
+			return;
+		}
+
+		// A deadline at or before now would make the work item spin
+		zassert_true((int32_t)(next - now) > 0, "deadline %u not after %u", next, now);
+		zassert_true(++guard < 100, "too many deadlines");
+
+		now = next;
+	}
+}
+
+static void before(void *fixture)
+{
+	(void) fixture;
+
+	fired_count = 0;
+	memset(fired, 0, sizeof(fired));
+
+	zassert_ok(gesture_init(&engine, table, ARRAY_SIZE(table), recognized, NULL));
+}
+
+ZTEST(gesture, test_tap)
+{
+	gesture_input(&engine, KEY_A, 1000);
+	gesture_input(&engine, 0, 1100);
+
+	zassert_equal(fired_count, 1);
+	zassert_equal(fired[0], ACTION_TAP_A);
+	zassert_equal(gesture_tick(&engine, 1100), GESTURE_NO_DEADLINE);
+}
+
+ZTEST(gesture, test_double_tap)
+{
+	gesture_input(&engine, KEY_B, 1000);
+	gesture_input(&engine, 0, 1050);
+	zassert_equal(fired_count, 0);
+
+	gesture_input(&engine, KEY_B, 1150);
+	gesture_input(&engine, 0, 1200);
+
+	zassert_equal(fired_count, 1);
+	zassert_equal(fired[0], ACTION_DOUBLE_TAP_B);
+}
+
+ZTEST(gesture, test_long_press)
+{
+	gesture_input(&engine, KEY_A, 5000);
+	zassert_equal(gesture_tick(&engine, 5000), 5600);
+
+	run_until(5000, 6000);
+	gesture_input(&engine, 0, 6000);
+
+	zassert_equal(fired_count, 1);
+	zassert_equal(fired[0], ACTION_LONG_PRESS_A);
+}
+
+ZTEST(gesture, test_long_press_chain)
+{
+	// Holds of one key fire shortest first, each from the same press
+	gesture_input(&engine, KEY_C, 1000);
+	zassert_equal(gesture_tick(&engine, 1000), 1500);
+
+	run_until(1000, 3000);
+	gesture_input(&engine, 0, 3000);
+
+	zassert_equal(fired_count, 2);
+	zassert_equal(fired[0], ACTION_LONG_PRESS_C);
+	zassert_equal(fired[1], ACTION_LONGER_PRESS_C);
+
+	// Released between the two
+	gesture_input(&engine, KEY_C, 4000);
+	run_until(4000, 4800);
+	gesture_input(&engine, 0, 4800);
+	run_until(4800, 7000);
+
+	zassert_equal(fired_count, 3);
+	zassert_equal(fired[2], ACTION_LONG_PRESS_C);
+}
+
+ZTEST(gesture, test_chord_hold)
+{
+	gesture_input(&engine, KEY_A, 100);
+	gesture_input(&engine, KEY_A | KEY_B, 120);
+	run_until(120, 2000);
+	gesture_input(&engine, 0, 2000);
+
+	zassert_equal(fired_count, 2);
+	zassert_equal(fired[0], ACTION_CHORD_AB);
+	zassert_equal(fired[1], ACTION_CHORD_HOLD_AB);
+}
+
+ZTEST(gesture, test_deadline_across_counter_wrap)
+{
+	uint32_t start = UINT32_MAX - 200;
+
+	gesture_input(&engine, KEY_A, start);
+	zassert_equal(gesture_tick(&engine, start), start + 600);
+
+	run_until(start, start + 1000);
+	gesture_input(&engine, 0, start + 1000);
+
+	zassert_equal(fired_count, 1);
+	zassert_equal(fired[0], ACTION_LONG_PRESS_A);
+}
+
+ZTEST(gesture, test_first_input_late_in_counter_range)
+{
+	// More than 2^31 ms after the engine was set up
+	uint32_t start = 0x80000000u + 12345;
+
+	gesture_input(&engine, KEY_A, start);
+	run_until(start, start + 1000);
+
+	zassert_equal(fired_count, 1);
+	zassert_equal(fired[0], ACTION_LONG_PRESS_A);
+}
+
+ZTEST(gesture, test_gap_longer_than_half_the_range)
+{
+	uint32_t start = 1000;
+
+	gesture_input(&engine, KEY_A, start);
+	gesture_input(&engine, 0, start + 50);
+	zassert_equal(fired_count, 1);
+
+	// Nothing happens for almost 25 days, then a long press
+	start += 0x80000000u + 777;
+
+	gesture_input(&engine, KEY_A, start);
+	run_until(start, start + 1000);
+
+	zassert_equal(fired_count, 2);
+	zassert_equal(fired[1], ACTION_LONG_PRESS_A);
+}
+
+ZTEST(gesture, test_gap_while_timer_pending)
+{
+	uint32_t start = 3000;
+
+	// The tick for the long press is late by more than a wheel revolution
+	gesture_input(&engine, KEY_A, start);
+	zassert_equal(gesture_tick(&engine, start + 100000), GESTURE_NO_DEADLINE);
+
+	zassert_equal(fired_count, 1);
+	zassert_equal(fired[0], ACTION_LONG_PRESS_A);
+}
+
+ZTEST_SUITE(gesture, NULL, NULL, before, NULL, NULL);
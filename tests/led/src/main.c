@@ -0,0 +1,156 @@
+/**
+ * @file    main.c
+ * @author  Matthijs Bakker
+ * @date    2026-10-18
+ * @brief   Tests of the GPIO LED backend
+ *
+ * The LEDs are pins of the GPIO emulator. The kernel clock of native_sim
+ * only moves while the test sleeps, so every pin is checked halfway between
+ * two edges of its pattern.
+ */
+
+#include <zephyr/ztest.h>
+#include <zephyr/drivers/gpio/gpio_emul.h>
+
+#include "led.h"
+
+static const struct gpio_dt_spec pins[__LED_INDEX_MAX] = {
+	[LED_INDEX_RED]   = GPIO_DT_SPEC_GET(DT_ALIAS(red_led), gpios),
+	[LED_INDEX_GREEN] = GPIO_DT_SPEC_GET(DT_ALIAS(green_led), gpios),
+	[LED_INDEX_BLUE]  = GPIO_DT_SPEC_GET(DT_ALIAS(blue_led), gpios),
+};
+
+static int lit(led_index_t index)
+{
+	return gpio_emul_output_get(pins[index].port, pins[index].pin);
+}
+
+static void *setup(void)
+{
+	zassert_ok(led_init());
+
+	return NULL;
+}
+
+static void before(void *fixture)
+{
+	int i;
+
+	ARG_UNUSED(fixture);
+
+	for (i = 0; i < __LED_INDEX_MAX; ++i) {
+		zassert_ok(led_stop(i, LED_PRIORITY_ALERT));
+		zassert_equal(lit(i), 0, "led %d", i);
+	}
+}
+
+ZTEST(led, test_single_blink)
+{
+	zassert_ok(led_play(LED_INDEX_BLUE, &led_pattern_short, LED_PRIORITY_ALERT));
+	zassert_equal(lit(LED_INDEX_BLUE), 1);
+
+	k_sleep(K_MSEC(50));
+	zassert_equal(lit(LED_INDEX_BLUE), 1);
+
+	k_sleep(K_MSEC(100));
+	zassert_equal(lit(LED_INDEX_BLUE), 0);
+
+	// A finished pattern does not hold its priority
+	zassert_ok(led_play(LED_INDEX_BLUE, &led_pattern_short, LED_PRIORITY_FEEDBACK));
+}
+
+ZTEST(led, test_endless_blink)
+{
+	int i;
+
+	zassert_ok(led_play(LED_INDEX_GREEN, &led_pattern_pending, LED_PRIORITY_STATUS));
+
+	k_sleep(K_MSEC(50));
+
+	for (i = 0; i < 10; ++i) {
+		zassert_equal(lit(LED_INDEX_GREEN), 1, "period %d", i);
+		k_sleep(K_MSEC(100));
+		zassert_equal(lit(LED_INDEX_GREEN), 0, "period %d", i);
+		k_sleep(K_MSEC(100));
+	}
+
+	zassert_ok(led_stop(LED_INDEX_GREEN, LED_PRIORITY_STATUS));
+	zassert_equal(lit(LED_INDEX_GREEN), 0);
+
+	k_sleep(K_MSEC(200));
+	zassert_equal(lit(LED_INDEX_GREEN), 0);
+}
+
+ZTEST(led, test_independent_deadlines)
+{
+	const led_pattern_t slow = { .on_ms = 300, .off_ms = 300, .repeat = 2, .brightness = LED_BRIGHTNESS_FULL };
+
+	// All LEDs share one timer, armed for the earliest edge
+	zassert_ok(led_play(LED_INDEX_RED, &led_pattern_short, LED_PRIORITY_STATUS));
+	zassert_ok(led_play(LED_INDEX_BLUE, &slow, LED_PRIORITY_STATUS));
+
+	k_sleep(K_MSEC(150));
+	zassert_equal(lit(LED_INDEX_RED), 0);
+	zassert_equal(lit(LED_INDEX_BLUE), 1);
+
+	k_sleep(K_MSEC(300));
+	zassert_equal(lit(LED_INDEX_BLUE), 0);
+
+	k_sleep(K_MSEC(300));
+	zassert_equal(lit(LED_INDEX_BLUE), 1);
+
+	k_sleep(K_MSEC(300));
+	zassert_equal(lit(LED_INDEX_BLUE), 0);
+
+	// Two repeats, no third on phase
+	k_sleep(K_MSEC(300));
+	zassert_equal(lit(LED_INDEX_BLUE), 0);
+}
+
+ZTEST(led, test_priority)
+{
+	zassert_ok(led_play(LED_INDEX_RED, &led_pattern_long, LED_PRIORITY_ALERT));
+
+	// Lower priorities neither replace nor stop the pattern
+	zassert_equal(led_play(LED_INDEX_RED, &led_pattern_short, LED_PRIORITY_FEEDBACK), 2);
+	zassert_equal(led_stop(LED_INDEX_RED, LED_PRIORITY_STATUS), 2);
+
+	k_sleep(K_MSEC(1000));
+	zassert_equal(lit(LED_INDEX_RED), 1);
+
+	zassert_ok(led_stop(LED_INDEX_RED, LED_PRIORITY_ALERT));
+	zassert_equal(lit(LED_INDEX_RED), 0);
+}
+
+ZTEST(led, test_color)
+{
+	const led_color_t cyan = { .green = 255, .blue = 64 };
+
+	zassert_ok(led_play(LED_INDEX_RED, &led_pattern_long, LED_PRIORITY_STATUS));
+	zassert_ok(led_play_color(&cyan, &led_pattern_normal, LED_PRIORITY_STATUS));
+
+	// The GPIO backend has no brightness, channels without any are stopped
+	zassert_equal(lit(LED_INDEX_RED), 0);
+	zassert_equal(lit(LED_INDEX_GREEN), 1);
+	zassert_equal(lit(LED_INDEX_BLUE), 1);
+
+	k_sleep(K_MSEC(600));
+	zassert_equal(lit(LED_INDEX_GREEN), 0);
+	zassert_equal(lit(LED_INDEX_BLUE), 0);
+}
+
+ZTEST(led, test_invalid)
+{
+	const led_pattern_t endless = { .on_ms = 100, .repeat = LED_REPEAT_FOREVER,
+					.brightness = LED_BRIGHTNESS_FULL };
+	const led_pattern_t dark = { .on_ms = 100, .repeat = 1 };
+
+	zassert_equal(led_play(__LED_INDEX_MAX, &led_pattern_short, LED_PRIORITY_ALERT), 1);
+	zassert_equal(led_play(LED_INDEX_RED, &endless, LED_PRIORITY_ALERT), 3);
+
+	// A pattern without brightness runs, but never lights the LED
+	zassert_ok(led_play(LED_INDEX_RED, &dark, LED_PRIORITY_STATUS));
+	zassert_equal(lit(LED_INDEX_RED), 0);
+}
+
+ZTEST_SUITE(led, NULL, setup, before, NULL, NULL);
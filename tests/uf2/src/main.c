@@ -0,0 +1,186 @@
+/**
+ * @file    main.c
+ * @author  Matthijs Bakker
+ * @date    2026-10-18
+ * @brief   Tests of the drag-and-drop firmware update disk
+ *
+ * UF2 blocks are written to the disk like a host would, in order, shuffled,
+ * repeated and after the image has been completed. The image slot lives in
+ * the flash simulator and is read back after every copy.
+ */
+
+#include <zephyr/ztest.h>
+#include <zephyr/storage/disk_access.h>
+#include <zephyr/storage/flash_map.h>
+#include <zephyr/sys/byteorder.h>
+
+#include "uf2.h"
+
+#define UF2_MAGIC_START0            0x0A324655
+#define UF2_MAGIC_START1            0x9E5D5157
+#define UF2_MAGIC_END               0x0AB16F30
+
+#define BLOCK_PAYLOAD               256
+#define IMAGE_BASE_ADDRESS          (CONFIG_FLASH_BASE_ADDRESS + FIXED_PARTITION_OFFSET(slot0_partition))
+#define IMAGE_END_ADDRESS           (IMAGE_BASE_ADDRESS + FIXED_PARTITION_SIZE(slot1_partition))
+
+// Any sector in the data area, the disk only looks at the contents
+#define DATA_SECTOR                 100
+
+static uint8_t sector[512];
+static uint8_t readback[BLOCK_PAYLOAD];
+
+static uint8_t pattern(uint8_t seed, uint32_t block_no, uint32_t i)
+{
+	return seed + block_no * 7 + i;
+}
+
+static int write_block_at(uint32_t address, uint32_t block_no, uint32_t num_blocks, uint8_t seed)
+{
+	uint32_t *words = (uint32_t *)sector;
+	uint32_t i;
+
+	memset(sector, 0, sizeof(sector));
+
+	words[0] = sys_cpu_to_le32(UF2_MAGIC_START0);
+	words[1] = sys_cpu_to_le32(UF2_MAGIC_START1);
+	words[2] = 0;
+	words[3] = sys_cpu_to_le32(address);
+	words[4] = sys_cpu_to_le32(BLOCK_PAYLOAD);
+	words[5] = sys_cpu_to_le32(block_no);
+	words[6] = sys_cpu_to_le32(num_blocks);
+	words[127] = sys_cpu_to_le32(UF2_MAGIC_END);
+
+	for (i = 0; i < BLOCK_PAYLOAD; ++i) {
+		sector[32 + i] = pattern(seed, block_no, i);
+	}
+
+	return disk_access_write(UF2_DISK_NAME, sector, DATA_SECTOR + block_no, 1);
+}
+
+static int write_block(uint32_t block_no, uint32_t num_blocks, uint8_t seed)
+{
+	return write_block_at(IMAGE_BASE_ADDRESS + block_no * BLOCK_PAYLOAD, block_no, num_blocks, seed);
+}
+
+static void check_image(uint32_t num_blocks, uint8_t seed)
+{
+	const struct flash_area *area;
+	uint32_t block_no, i;
+
+	zassert_ok(flash_area_open(FIXED_PARTITION_ID(slot1_partition), &area));
+
+	for (block_no = 0; block_no < num_blocks; ++block_no) {
+		zassert_ok(flash_area_read(area, block_no * BLOCK_PAYLOAD, readback, sizeof(readback)));
+
+		for (i = 0; i < BLOCK_PAYLOAD; ++i) {
+			zassert_equal(readback[i], pattern(seed, block_no, i),
+				      "block %u byte %u", block_no, i);
+		}
+	}
+
+	flash_area_close(area);
+}
+
+static void *setup(void)
+{
+	zassert_ok(uf2_init());
+	zassert_ok(disk_access_init(UF2_DISK_NAME));
+
+	return NULL;
+}
+
+/*
+ * Every test copies an image with its own block count, so that the disk
+ * treats it as a new image.
+ */
+
+ZTEST(uf2, test_in_order)
+{
+	uint32_t i;
+
+	for (i = 0; i < 40; ++i) {
+		zassert_ok(write_block(i, 40, 0x10));
+	}
+
+	check_image(40, 0x10);
+}
+
+ZTEST(uf2, test_out_of_order)
+{
+	uint32_t i;
+
+	// Odd blocks from the end, then the even blocks from the start
+	for (i = 41; i-- > 0;) {
+		if (i & 1) {
+			zassert_ok(write_block(i, 41, 0x20));
+		}
+	}
+
+	for (i = 0; i < 41; i += 2) {
+		zassert_ok(write_block(i, 41, 0x20));
+	}
+
+	check_image(41, 0x20);
+}
+
+ZTEST(uf2, test_duplicates)
+{
+	uint32_t i;
+
+	// A repeated block is not programmed again, which would fail on unerased flash
+	for (i = 0; i < 42; ++i) {
+		zassert_ok(write_block(i, 42, 0x30));
+		zassert_ok(write_block(i, 42, 0x31));
+	}
+
+	check_image(42, 0x30);
+}
+
+ZTEST(uf2, test_after_completion)
+{
+	uint32_t i;
+
+	for (i = 0; i < 43; ++i) {
+		zassert_ok(write_block(i, 43, 0x40));
+	}
+
+	// Blocks of the same image after completion leave the slot alone
+	for (i = 0; i < 43; ++i) {
+		zassert_ok(write_block(i, 43, 0x41));
+	}
+
+	check_image(43, 0x40);
+
+	// An image with another block count starts over
+	for (i = 0; i < 44; ++i) {
+		zassert_ok(write_block(i, 44, 0x50));
+	}
+
+	check_image(44, 0x50);
+}
+
+ZTEST(uf2, test_too_many_blocks)
+{
+	zassert_not_equal(write_block(0, 1 << 20, 0x60), 0);
+}
+
+ZTEST(uf2, test_outside_slot)
+{
+	uint32_t i;
+
+	// The block counts are valid, only the target addresses are not
+	zassert_not_equal(write_block_at(IMAGE_BASE_ADDRESS - BLOCK_PAYLOAD, 0, 45, 0x70), 0);
+	zassert_not_equal(write_block_at(IMAGE_END_ADDRESS - BLOCK_PAYLOAD / 2, 1, 45, 0x70), 0);
+	zassert_not_equal(write_block_at(IMAGE_END_ADDRESS, 2, 45, 0x70), 0);
+	zassert_not_equal(write_block_at(UINT32_MAX - BLOCK_PAYLOAD / 2, 3, 45, 0x70), 0);
+
+	// The rejected blocks did not count towards the image
+	for (i = 0; i < 45; ++i) {
+		zassert_ok(write_block(i, 45, 0x71));
+	}
+
+	check_image(45, 0x71);
+}
+
+ZTEST_SUITE(uf2, NULL, setup, NULL, NULL, NULL);
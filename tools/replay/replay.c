@@ -0,0 +1,386 @@
+/**
+ * @file    replay.c
+ * @author  Matthijs Bakker
+ * @date    2026-10-18
+ * @brief   Replay a RECORD.BIN through the touch detection on the host
+ *
+ * The recorded samples are fed through the same detect.c as the firmware,
+ * optionally with different tuning. The detected state changes are matched
+ * against reference events: the ones the firmware recorded, or a label
+ * file with the actual touches. Unmatched reference events are misses,
+ * unmatched detections are false positives.
+ */
+
+#include "detect.h"
+#include "recorder.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_EVENTS                  4096
+#define DEFAULT_WINDOW_MS           250
+#define DEFAULT_ITERATIONS          1000
+
+typedef struct {
+	uint32_t time_ms;
+	uint8_t pad;
+	bool pressed;
+	bool matched;
+} replay_event_t;
+
+typedef struct {
+	replay_event_t items[MAX_EVENTS];
+	size_t count;
+} replay_events_t;
+
+static recorder_header_t header;
+static recorder_record_t *records;
+static size_t record_count;
+
+static replay_events_t reference, detected;
+
+static void usage(const char *name)
+{
+	fprintf(stderr,
+		"Usage: %s [options] RECORD.BIN\n"
+		"  -t RATIO    touch threshold relative to the baseline\n"
+		"  -d COUNT    scans a state change must persist before it is accepted\n"
+		"  -c COUNT    calibration scans\n"
+		"  -C          calibrate from the start of the recording, not the stored baselines\n"
+		"  -l FILE     reference events, lines of \"<ms> <pad> press|release\"\n"
+		"  -w MS       maximum distance between a reference event and its detection\n"
+		"  -n COUNT    iterations of the throughput measurement\n"
+		"  -v          print every reference event\n",
+		name);
+}
+
+static void event_add(replay_events_t *events, uint32_t time_ms, uint8_t pad, bool pressed)
+{
+	if (events->count >= MAX_EVENTS) {
+		return;
+	}
+
+	events->items[events->count++] = (replay_event_t) {
+		.time_ms = time_ms,
+		.pad = pad,
+		.pressed = pressed,
+	};
+}
+
+/**
+ * @returns 0 on success,
+ *          >0 if the file could not be read or is not a recording
+ */
+static int load_recording(const char *path)
+{
+	FILE *file = fopen(path, "rb");
+	int err = 0;
+
+	if (!file) {
+		perror(path);
+		return 1;
+	}
+
+	if (fread(&header, sizeof(header), 1, file) != 1 ||
+	    header.magic != RECORDER_MAGIC || header.version != RECORDER_VERSION) {
+		fprintf(stderr, "%s: not a recording\n", path);
+		err = 2;
+		goto out;
+	}
+
+	records = calloc(header.record_count, sizeof(recorder_record_t));
+
+	if (!records) {
+		err = 3;
+		goto out;
+	}
+
+	record_count = fread(records, sizeof(recorder_record_t), header.record_count, file);
+
+	if (record_count < header.record_count) {
+		fprintf(stderr, "%s: truncated, %zu of %u records\n", path, record_count, header.record_count);
+	}
+
+out:
+	fclose(file);
+	return err;
+}
+
+/**
+ * @returns 0 on success,
+ *          >0 if the file could not be read
+ */
+static int load_labels(const char *path)
+{
+	FILE *file = fopen(path, "r");
+	char line[128], state[16];
+	unsigned int time_ms, pad;
+
+	if (!file) {
+		perror(path);
+		return 1;
+	}
+
+	while (fgets(line, sizeof(line), file)) {
+		if (line[0] == '#' || sscanf(line, "%u %u %15s", &time_ms, &pad, state) != 3) {
+			continue;
+		}
+
+		event_add(&reference, time_ms, pad, !strcmp(state, "press"));
+	}
+
+	fclose(file);
+	return 0;
+}
+
+static int pad_count(void)
+{
+	uint8_t count = header.pad_count;
+	size_t i;
+
+	// Recordings taken before calibration finished do not know the pad count yet
+	for (i = 0; i < record_count; ++i) {
+		if (records[i].pad >= count) {
+			count = records[i].pad + 1;
+		}
+	}
+
+	return count;
+}
+
+/**
+ * Feed all samples through the detector.
+ *
+ * @param events        receives the detected state changes, or NULL
+ * @param warmup_ms     receives the end of the warm-up period, or NULL
+ *
+ * @returns the number of samples fed
+ */
+static size_t run(const detect_config_t *config, bool calibrate, replay_events_t *events, uint32_t *warmup_ms)
+{
+	detect_t detect;
+	detect_event_t event;
+	int prev_pad = -1;
+	size_t samples = 0;
+	size_t scans = 0;
+	size_t i;
+
+	// The configuration and pad count were checked before the first run
+	if (detect_init(&detect, config, pad_count())) {
+		return 0;
+	}
+
+	if (!calibrate) {
+		detect_set_baselines(&detect, header.baselines);
+	}
+
+	for (i = 0; i < record_count; ++i) {
+		const recorder_record_t *record = &records[i];
+
+		if (record->flags & (RECORDER_FLAG_PRESS | RECORDER_FLAG_RELEASE | RECORDER_FLAG_LOST)) {
+			continue;
+		}
+
+		// Every scan samples the pads in order, a lower index starts the next scan
+		if (record->pad <= prev_pad) {
+			detect_scan_end(&detect);
+
+			// The pad states at the start of the ring are unknown, give the detector time to settle
+			if (++scans == config->debounce + 1u && warmup_ms) {
+				*warmup_ms = record->time_ms;
+			}
+		}
+
+		prev_pad = record->pad;
+		++samples;
+
+		event = detect_sample(&detect, record->pad, record->value);
+
+		if (event != DETECT_EVENT_NONE && events) {
+			event_add(events, record->time_ms, record->pad, event == DETECT_EVENT_PRESS);
+		}
+	}
+
+	return samples;
+}
+
+static void match_events(uint32_t window_ms, uint32_t warmup_ms, bool verbose)
+{
+	uint32_t matched = 0, misses = 0, false_positives = 0;
+	int64_t latency_sum = 0;
+	int32_t latency_min = INT32_MAX, latency_max = INT32_MIN;
+	size_t i, j;
+
+	for (i = 0; i < reference.count; ++i) {
+		replay_event_t *ref = &reference.items[i];
+		replay_event_t *hit = NULL;
+		int32_t latency;
+
+		if (ref->time_ms < warmup_ms) {
+			continue;
+		}
+
+		for (j = 0; j < detected.count && !hit; ++j) {
+			replay_event_t *det = &detected.items[j];
+			int32_t distance = (int32_t)(det->time_ms - ref->time_ms);
+
+			if (!det->matched && det->pad == ref->pad && det->pressed == ref->pressed &&
+			    abs(distance) <= (int32_t)window_ms) {
+				hit = det;
+			}
+		}
+
+		if (!hit) {
+			++misses;
+
+			if (verbose) {
+				printf("%10u ms  pad %u %-7s missed\n", ref->time_ms, ref->pad, ref->pressed ? "press" : "release");
+			}
+
+			continue;
+		}
+
+		hit->matched = true;
+		latency = (int32_t)(hit->time_ms - ref->time_ms);
+
+		++matched;
+		latency_sum += latency;
+		latency_min = (latency < latency_min) ? latency : latency_min;
+		latency_max = (latency > latency_max) ? latency : latency_max;
+
+		if (verbose) {
+			printf("%10u ms  pad %u %-7s latency %d ms\n", ref->time_ms, ref->pad, ref->pressed ? "press" : "release", latency);
+		}
+	}
+
+	for (j = 0; j < detected.count; ++j) {
+		if (!detected.items[j].matched && detected.items[j].time_ms >= warmup_ms) {
+			++false_positives;
+
+			if (verbose) {
+				printf("%10u ms  pad %u %-7s false positive\n", detected.items[j].time_ms, detected.items[j].pad,
+				       detected.items[j].pressed ? "press" : "release");
+			}
+		}
+	}
+
+	printf("reference_events   %zu\n", reference.count);
+	printf("detected_events    %zu\n", detected.count);
+	printf("matched            %u\n", matched);
+	printf("misses             %u\n", misses);
+	printf("false_positives    %u\n", false_positives);
+
+	if (matched) {
+		printf("latency_mean_ms    %.1f\n", (double)latency_sum / matched);
+		printf("latency_min_ms     %d\n", latency_min);
+		printf("latency_max_ms     %d\n", latency_max);
+	}
+}
+
+static void measure_throughput(const detect_config_t *config, bool calibrate, unsigned int iterations)
+{
+	struct timespec start, end;
+	size_t samples = 0;
+	unsigned int i;
+	double elapsed;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (i = 0; i < iterations; ++i) {
+		samples += run(config, calibrate, NULL, NULL);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+	printf("samples_per_sec    %.0f\n", elapsed > 0 ? samples / elapsed : 0);
+}
+
+int main(int argc, char **argv)
+{
+	detect_config_t config = DETECT_CONFIG_DEFAULT;
+	const char *labels = NULL;
+	uint32_t window_ms = DEFAULT_WINDOW_MS;
+	uint32_t warmup_ms = 0;
+	unsigned int iterations = DEFAULT_ITERATIONS;
+	bool calibrate = false;
+	bool verbose = false;
+	size_t i;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "t:d:c:Cl:w:n:v")) != -1) {
+		switch (opt) {
+			case 't':
+				config.threshold_ratio = atof(optarg);
+				break;
+			case 'd':
+				config.debounce = atoi(optarg);
+				break;
+			case 'c':
+				config.calibration_runs = atoi(optarg);
+				break;
+			case 'C':
+				calibrate = true;
+				break;
+			case 'l':
+				labels = optarg;
+				break;
+			case 'w':
+				window_ms = atoi(optarg);
+				break;
+			case 'n':
+				iterations = atoi(optarg);
+				break;
+			case 'v':
+				verbose = true;
+				break;
+			default:
+				usage(argv[0]);
+				return 1;
+		}
+	}
+
+	if (optind != argc - 1) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	if (load_recording(argv[optind])) {
+		return 1;
+	}
+
+	// Without stored baselines, the recording has to start with the calibration
+	calibrate |= !header.calibrated;
+
+	if (detect_init(&(detect_t) {0}, &config, pad_count())) {
+		fprintf(stderr, "%s: invalid tuning for %d pads\n", argv[optind], pad_count());
+		free(records);
+		return 1;
+	}
+
+	if (labels) {
+		if (load_labels(labels)) {
+			return 1;
+		}
+	} else {
+		for (i = 0; i < record_count; ++i) {
+			if (records[i].flags & (RECORDER_FLAG_PRESS | RECORDER_FLAG_RELEASE)) {
+				event_add(&reference, records[i].time_ms, records[i].pad, records[i].flags & RECORDER_FLAG_PRESS);
+			}
+		}
+	}
+
+	printf("records            %zu\n", record_count);
+	printf("samples            %zu\n", run(&config, calibrate, &detected, calibrate ? NULL : &warmup_ms));
+
+	match_events(window_ms, warmup_ms, verbose);
+	measure_throughput(&config, calibrate, iterations);
+
+	free(records);
+
+	return 0;
+}